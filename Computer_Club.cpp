@@ -1,240 +1,523 @@
 #include "Computer_Club.h"
+#include "binary_log.h"
+#include "event_pipeline.h"
 #include "helper_functions.h"
+#include "parallel_parser.h"
 #include "parsing_functions.h"
+#include <filesystem>
 
-std::optional<Event> Computer_Club::handle_client_arrival_(const Time& arrival_time, const std::string& event_body)
+std::optional<Event_View> Computer_Club::handle_client_arrival_(const Time& arrival_time, int client, std::string_view event_body)
 {
-    const std::string& client_name = event_body;
-    if (!is_valid_client_name(client_name)) {
-        return Event(arrival_time, 13, "Invalid client name: " + client_name);
+    // only valid names are interned, so an invalid one never got an ID
+    if (client == no_client) {
+        return Event_View::error_event(arrival_time, Club_Error::invalid_client_name, event_body);
     }
 
-    if (client_exists(clients_, client_name)) {
-        return Event(arrival_time, 13, "YouShallNotPass");
+    if (client_exists(clients_, client)) {
+        return Event_View::error_event(arrival_time, Club_Error::you_shall_not_pass);
     }
 
     bool valid_arrival_time = arrival_time >= start_time_ && arrival_time <= end_time_;
     if (!valid_arrival_time) {
-        return Event(arrival_time, 13, "NotOpenYet");
+        return Event_View::error_event(arrival_time, Club_Error::not_open_yet);
     }
 
-    Client new_client(client_name);
-    clients_[client_name] = new_client;
+    clients_[client] = Client();
+    clients_[client].present = true;
 
     return std::nullopt;
 }
-std::optional<Event> Computer_Club::handle_client_sit_(const Time& event_time, const std::string& event_body)
+std::optional<Event_View> Computer_Club::handle_client_sit_(const Time& event_time, int client, int table_number, std::string_view event_body)
 {
-    std::regex sit_regex("^([a-z0-9_-]+) (\\d+)$");
-    std::smatch match;
-    if (!std::regex_match(event_body, match, sit_regex)) {
-        return Event(event_time, 13,
-            "Error: invalid sit event body: <" + event_body + ">");
+    // the body was already split into client and table number by the lexer
+    if (table_number == no_table) {
+        return Event_View::error_event(event_time, Club_Error::invalid_sit_body, event_body);
+    }
+    if (table_number == table_overflow) {
+        throw std::out_of_range("stoi");
     }
 
-    std::string client_name = match[1];
-    int table_number = std::stoi(match[2]);
-
-    if (!is_valid_table_number(table_number, tables_)) {
-        return Event(event_time, 13,
-            "Error: table number <" + std::to_string(table_number) + "> is out of range");
+    // tables are numbered from first_table_ on, errors quote the number as given
+    int local_number = table_number - first_table_ + 1;
+    if (!is_valid_table_number(local_number, tables_)) {
+        return Event_View::error_event(event_time, Club_Error::table_out_of_range, {}, client, table_number);
     }
 
-    if (is_table_occupied(tables_, table_number)) {
-        return Event(event_time, 13, "PlaceIsBusy");
+    if (is_table_occupied(tables_, local_number)) {
+        return Event_View::error_event(event_time, Club_Error::place_is_busy);
     }
 
-    if (!client_exists(clients_, client_name)) {
-        return Event(event_time, 13, "ClientUnknown");
+    if (!client_exists(clients_, client)) {
+        return Event_View::error_event(event_time, Club_Error::client_unknown);
     }
 
-    int table_index = table_number - 1;
-    tables_[table_index].occupied = true;
-    tables_[table_index].occupied_time_start = event_time;
-    clients_[client_name].table_number = table_index;
-    clients_[client_name].seated = true;
+    int table_index = local_number - 1;
+    occupy_table(tables_, table_index, event_time);
+    clients_[client].table_number = table_index;
+    clients_[client].seated = true;
 
     return std::nullopt;
 }
-std::optional<Event> Computer_Club::handle_client_start_waiting_(const Time& event_time, const std::string& event_body)
+std::optional<Event_View> Computer_Club::handle_client_start_waiting_(const Time& event_time, int client, std::string_view event_body)
 {
-    const std::string& client_name = event_body;
-    if (!is_valid_client_name(client_name)) {
-        return Event(event_time, 13, "Invalid client name: " + client_name);
+    if (client == no_client) {
+        return Event_View::error_event(event_time, Club_Error::invalid_client_name, event_body);
     }
 
-    if (!client_exists(clients_, client_name)) {
-        return Event(event_time, 13, "ClientUnknown");
+    if (!client_exists(clients_, client)) {
+        return Event_View::error_event(event_time, Club_Error::client_unknown);
     }
 
-    if (is_table_available(tables_)) {
-        return Event(event_time, 13, "ICanWaitNoLonger!");
+    if (is_table_available(tables_.free)) {
+        return Event_View::error_event(event_time, Club_Error::i_can_wait_no_longer);
     }
 
-    if (clients_[client_name].seated) {
-        return Event(event_time, 13, "Error: client " + client_name + " is happily seated and doesn't want to enter the waiting list");
+    if (clients_[client].seated) {
+        return Event_View::error_event(event_time, Club_Error::client_seated, {}, client);
     }
 
-    bool queue_at_full_capacity = waiting_list_.size() == tables_.size();
+    bool queue_at_full_capacity = waiting_list_.size() == queue_capacity_;
     if (queue_at_full_capacity) {
-        Event leave_event(event_time, 11, client_name);
-        return leave_event;
+        return Event_View::generated_event(event_time, 11, client);
     }
 
-    waiting_list_.push(clients_[client_name]);
+    waiting_list_.push(client);
 
     return std::nullopt;
 }
-std::optional<Event> Computer_Club::handle_client_leave_table_(const Time& event_time, const std::string& event_body)
+std::optional<Event_View> Computer_Club::handle_client_leave_table_(const Time& event_time, int client, std::string_view event_body)
 {
-    const std::string& client_name = event_body;
-    if (!is_valid_client_name(client_name)) {
-        return Event(event_time, 13, "Invalid client name: " + client_name);
+    if (client == no_client) {
+        return Event_View::error_event(event_time, Club_Error::invalid_client_name, event_body);
     }
 
-    if (!client_exists(clients_, client_name)) {
-        return Event(event_time, 13, "ClientUnknown");
+    if (!client_exists(clients_, client)) {
+        return Event_View::error_event(event_time, Club_Error::client_unknown);
     }
 
-    Client& client = clients_[client_name];
-    if (!client.seated) {
-        return Event(event_time, 13,
-            "Error: client " + client_name + " is not seated");
+    if (!clients_[client].seated) {
+        return Event_View::error_event(event_time, Club_Error::client_not_seated, {}, client);
     }
 
-    free_table(tables_[client.table_number], event_time, cost_per_hour_);
+    int table_index = clients_[client].table_number;
+    free_table_(table_index, event_time);
 
-    clients_.erase(client_name);
+    clients_[client] = Client();
 
     // find a client from the waiting list to sit at the freed table
     if (!waiting_list_.empty()) {
-        Client next_client = waiting_list_.front();
-        waiting_list_.pop();
-        return Event(
-            event_time, 12,
-            next_client.name + " " + std::to_string(client.table_number + 1));
+        int next_client = waiting_list_.pop();
+        return Event_View::generated_event(event_time, 12, next_client, table_index + first_table_);
     }
 
     return std::nullopt;
 }
-void Computer_Club::handle_client_leave_(const Time& event_time, const std::string& event_body)
+void Computer_Club::handle_client_leave_(const Time& event_time, int client)
 {
-    const std::string& client_name = event_body;
-    if (!is_valid_client_name(client_name)) {
-        return;
-    }
-
-    if (!client_exists(clients_, client_name)) {
+    if (!client_exists(clients_, client)) {
         return;
     }
 
-    Client& client = clients_[client_name];
-    if (client.seated) {
-        free_table(tables_[client.table_number], event_time, cost_per_hour_);
+    if (clients_[client].seated) {
+        free_table_(clients_[client].table_number, event_time);
     }
 
     // if client was at waiting list, remove it, keeping the order
-    waiting_list_ = remove_client_from_queue(waiting_list_, client_name);
+    waiting_list_.remove(client);
 
-    clients_.erase(client_name);
+    clients_[client] = Client();
 }
-std::optional<Event> Computer_Club::handle_event_(Event& event)
+std::optional<Event_View> Computer_Club::handle_event_(const Event_View& event)
 {
-    std::optional<Event> new_event;
+    std::optional<Event_View> new_event;
 
     switch (event.ID) {
     case 1:
-        new_event = handle_client_arrival_(event.time, event.body);
+        new_event = handle_client_arrival_(event.time, event.client, event.body);
         break;
     case 2:
-        new_event = handle_client_sit_(event.time, event.body);
+        new_event = handle_client_sit_(event.time, event.client, event.table, event.body);
         break;
     case 3:
-        new_event = handle_client_start_waiting_(event.time, event.body);
+        new_event = handle_client_start_waiting_(event.time, event.client, event.body);
         break;
     case 4:
-        new_event = handle_client_leave_table_(event.time, event.body);
+        new_event = handle_client_leave_table_(event.time, event.client, event.body);
         break;
     case 11:
-        handle_client_leave_(event.time, event.body);
+        handle_client_leave_(event.time, event.client);
         break;
     case 12:
-        handle_client_sit_(event.time, event.body);
+        handle_client_sit_(event.time, event.client, event.table, event.body);
         break;
     case 13:
         break;
     default:
-        new_event = Event(event.time, 13, "Error: unknown event ID");
+        new_event = Event_View::error_event(event.time, Club_Error::unknown_event_id);
     }
 
     return new_event;
 }
-void Computer_Club::process_events_(std::vector<Event>& events)
+void Computer_Club::process_event_(const Event_View& event)
 {
-    size_t i = 0;
-    size_t events_size = events.size();
-    while (i < events_size) {
-        Event& event = events[i];
-        std::cout << event << std::endl;
+    // names interned since the last event get their (empty) client slots
+    if (clients_.size() < events_->names().size()) {
+        clients_.resize(events_->names().size());
+    }
+
+    metrics_.lap(Phase::parse);
+    if (event.time > end_time_ && start_time_.dated()) {
+        start_next_shift_(event.time);
+    }
+    metrics_.count_event(event);
+    output_.write_event(event, events_->names());
+    metrics_.lap(Phase::output);
+
+    if (event.time > end_time_) {
+        Event_View late_event = Event_View::error_event(event.time, Club_Error::after_closing_time);
+        metrics_.count_event(late_event);
+        output_.write_event(late_event, events_->names());
+        metrics_.lap(Phase::output);
+        metrics_.end_event();
+        return;
+    }
 
-        if (event.time > end_time_) {
-            Event late_event(event.time, 13, "Error: event is after closing time");
-            std::cout << late_event << std::endl;
-            ++i;
+    // a handled event may generate a new one (11, 12 or 13) that has to be handled in turn
+    std::optional<Event_View> new_event = handle_event_(event);
+    metrics_.record_handler(event.ID, metrics_.lap(Phase::simulate));
+    while (new_event.has_value()) {
+        Event_View generated_event = new_event.value();
+        metrics_.count_event(generated_event);
+        output_.write_event(generated_event, events_->names());
+        metrics_.lap(Phase::output);
+        new_event = handle_event_(generated_event);
+        metrics_.record_handler(generated_event.ID, metrics_.lap(Phase::simulate));
+    }
+    metrics_.observe_queue(waiting_list_.size());
+    metrics_.end_event();
+}
+void Computer_Club::process_events_(Event_Source& events)
+{
+    // every event is handled as soon as it is parsed, nothing is buffered
+    Event_View event(end_time_, 0, {});
+    metrics_.start_lap();
+    while (events.next(event)) {
+        process_event_(event);
+        if (checkpoint_due_(event.time)) {
+            save_checkpoint_(event.time);
+        }
+    }
+    close_day_();
+}
+void Computer_Club::free_table_(int table_index, const Time& event_time)
+{
+    int revenue = tables_.revenue[table_index];
+    free_table(tables_, table_index, event_time, cost_per_hour_);
+    if (occupancy_ != nullptr) {
+        occupancy_->intervals.push_back({ table_index, tables_.start[table_index], event_time.minutes, tables_.revenue[table_index] - revenue });
+    }
+}
+void Computer_Club::close_day_()
+{
+    // Clients that are still in the club leave at closing time. These departures
+    // print nothing, so instead of walking them one by one (in name order)
+    // through handle_client_leave_, all their tables are billed in one batch.
+    metrics_.start_lap();
+    std::vector<uint64_t> closing(tables_.free.words.size(), 0);
+    for (int client = 0; client < int(clients_.size()); ++client) {
+        if (!clients_[client].present) {
             continue;
         }
+        if (clients_[client].seated) {
+            int table_index = clients_[client].table_number;
+            closing[table_index / 64] |= uint64_t(1) << (table_index % 64);
+        }
+        waiting_list_.remove(client);
+        clients_[client] = Client();
+    }
+    if (occupancy_ == nullptr) {
+        free_tables_at_close(tables_, closing, end_time_, cost_per_hour_);
+    } else {
+        for (size_t word = 0; word < closing.size(); ++word) {
+            for (uint64_t bits = closing[word]; bits != 0; bits &= bits - 1) {
+                free_table_(int(word * 64) + std::countr_zero(bits), end_time_);
+            }
+        }
+        occupancy_->shifts.emplace_back(start_time_, end_time_);
+    }
+    metrics_.lap(Phase::simulate);
+}
+void Computer_Club::start_next_shift_(const Time& event_time)
+{
+    // the shift that closed before event_time is reported like a whole day,
+    // then the tables start over for the first shift that event_time is in
+    close_day_();
+    output_.write_time(end_time_);
+    print_tables();
+    initialize_tables_(tables_.size());
+
+    Minutes days = (event_time.minutes - end_time_.minutes + minutes_per_day - 1) / minutes_per_day;
+    start_time_ += Time::from_minutes(days * minutes_per_day);
+    end_time_ += Time::from_minutes(days * minutes_per_day);
+    output_.write_time(start_time_);
+}
+bool Computer_Club::ingest_line(std::string_view line)
+{
+    pushed_events_->push(line);
+    Event_View event(end_time_, 0, {});
+    metrics_.start_lap(); // the wait for this line isn't parsing
+    if (!pushed_events_->next(event)) {
+        return false;
+    }
+    process_event_(event);
+    last_event_time_ = event.time;
+    return true;
+}
+void Computer_Club::close_day()
+{
+    close_day_();
+}
+Club_Status Computer_Club::status() const
+{
+    Club_Status status {};
+    status.last_event_time = last_event_time_;
+    status.free_tables = tables_.free.free_count;
+    status.queue_length = waiting_list_.size();
+    status.clients_present = int(std::count_if(clients_.begin(), clients_.end(),
+        [](const Client& client) { return client.present; }));
+    status.tables.reserve(tables_.size());
+    status.occupied.reserve(tables_.size());
+    for (int i = 0; i < tables_.size(); ++i) {
+        status.tables.push_back(tables_.row(i));
+        status.tables.back().number += first_table_ - 1;
+        status.occupied.push_back(tables_.occupied(i));
+    }
+    return status;
+}
+void Computer_Club::initialize_tables_(int num_of_tables)
+{
+    if (num_of_tables < 0) {
+        throw std::length_error("vector::reserve"); // what reserving tables for it used to throw
+    }
+    tables_.reset(num_of_tables);
+}
+bool Computer_Club::checkpoint_due_(const Time& event_time)
+{
+    if (checkpoints_.path.empty()) {
+        return false;
+    }
+    ++events_since_checkpoint_;
+    bool by_events = checkpoints_.every_events > 0 && events_since_checkpoint_ >= checkpoints_.every_events;
+    bool by_time = checkpoints_.every_minutes > 0
+        && event_time - last_checkpoint_time_ >= Time::from_minutes(checkpoints_.every_minutes);
+    return by_events || by_time;
+}
+void Computer_Club::save_checkpoint_(const Time& event_time)
+{
+    // everything written so far has to be out before the checkpoint says so
+    output_.flush();
+
+    Snapshot_Writer snapshot;
+    snapshot.put(int32_t(tables_.size()));
+    snapshot.put(start_time_.minutes); // of the current shift
+    snapshot.put(end_time_.minutes);
+    snapshot.put(int32_t(cost_per_hour_));
+    snapshot.put(events_->position());
+    snapshot.put(event_time.minutes);
+
+    const Name_Table& names = events_->names();
+    snapshot.put(uint64_t(names.size()));
+    for (size_t id = 0; id < names.size(); ++id) {
+        snapshot.put_string(names.name(int(id)));
+    }
 
-        std::optional<Event> new_event = handle_event_(event);
+    snapshot.put(uint64_t(clients_.size()));
+    for (const Client& client : clients_) {
+        snapshot.put(uint8_t(client.present));
+        snapshot.put(uint8_t(client.seated));
+        snapshot.put(int32_t(client.table_number));
+    }
 
-        if (new_event.has_value()) {
-            event = new_event.value(); // replace the current event with the new one
-            continue; // don't increment i, so we can process this new event in the next iteration
-        }
+    snapshot.put_array(tables_.free.words);
+    snapshot.put_array(tables_.start);
+    snapshot.put_array(tables_.occupied_minutes);
+    snapshot.put_array(tables_.revenue);
+    snapshot.put_array(waiting_list_.clients());
 
-        ++i;
+    write_file_atomically(checkpoints_.path, snapshot.bytes());
+    events_since_checkpoint_ = 0;
+    last_checkpoint_time_ = event_time;
+}
+void Computer_Club::restore_checkpoint_()
+{
+    Mapped_File checkpoint_file(checkpoints_.path);
+    Snapshot_Reader snapshot(checkpoint_file.data());
+
+    // the checkpoint's shift is this header's one, or a shift a whole number of days later
+    int32_t num_of_tables = snapshot.get<int32_t>();
+    Time shift_start = Time::from_minutes(snapshot.get<Minutes>());
+    Time shift_end = Time::from_minutes(snapshot.get<Minutes>());
+    Minutes days_later = shift_start.minutes - start_time_.minutes;
+    bool same_shift = days_later == 0
+        || (start_time_.dated() && days_later > 0 && days_later % minutes_per_day == 0);
+    bool same_input = num_of_tables == tables_.size()
+        && same_shift
+        && shift_end.minutes - shift_start.minutes == end_time_.minutes - start_time_.minutes
+        && snapshot.get<int32_t>() == cost_per_hour_;
+    if (!same_input) {
+        throw std::runtime_error("Error: checkpoint <" + checkpoints_.path + "> belongs to another input");
     }
+    uint64_t position = snapshot.get<uint64_t>();
+    last_checkpoint_time_ = Time::from_minutes(snapshot.get<Minutes>());
 
-    // handle clients that are still in the club after closing time
-    std::vector<std::string> remaining_clients_names;
-    remaining_clients_names.reserve(clients_.size());
-    for (const auto& client : clients_) {
-        remaining_clients_names.push_back(client.first);
+    Name_Table names;
+    uint64_t num_of_names = snapshot.get<uint64_t>();
+    for (uint64_t id = 0; id < num_of_names; ++id) {
+        names.intern(snapshot.get_string());
     }
 
-    std::sort(remaining_clients_names.begin(), remaining_clients_names.end());
+    clients_.resize(snapshot.get<uint64_t>());
+    for (Client& client : clients_) {
+        client.present = snapshot.get<uint8_t>() != 0;
+        client.seated = snapshot.get<uint8_t>() != 0;
+        client.table_number = snapshot.get<int32_t>();
+    }
 
-    for (const auto& client_name : remaining_clients_names) {
-        Event leave_event(end_time_, 11, client_name);
-        handle_client_leave_(leave_event.time, leave_event.body);
+    auto restore_column = [&snapshot](auto& column) {
+        auto values = snapshot.get_array<typename std::decay_t<decltype(column)>::value_type>();
+        column.assign(values.begin(), values.end());
+    };
+    restore_column(tables_.free.words);
+    restore_column(tables_.start);
+    restore_column(tables_.occupied_minutes);
+    restore_column(tables_.revenue);
+    for (int client : snapshot.get_array<int>()) {
+        waiting_list_.push(client);
     }
-}
-void Computer_Club::initialize_tables_(int num_of_tables)
-{
-    tables_.reserve(num_of_tables); // performance boost if N is big
-    for (int i = 1; i <= num_of_tables; ++i) {
-        tables_.emplace_back(i);
+
+    size_t num_of_words = (size_t(tables_.size()) + 63) / 64;
+    bool consistent = snapshot.at_end() && names.size() == clients_.size()
+        && tables_.free.words.size() == num_of_words
+        && tables_.occupied_minutes.size() == tables_.start.size()
+        && tables_.revenue.size() == tables_.start.size();
+    if (!consistent) {
+        throw std::runtime_error("Error: checkpoint <" + checkpoints_.path + "> is corrupt");
     }
+    tables_.free.free_count = 0;
+    for (uint64_t word : tables_.free.words) {
+        tables_.free.free_count += std::popcount(word);
+    }
+    tables_.free.first_word = 0;
+
+    start_time_ = shift_start;
+    end_time_ = shift_end;
+    events_->restore_names(names);
+    events_->seek(position);
+    resumed_ = true;
 }
-Computer_Club::Computer_Club(const std::string& filename)
-    : start_time_(0, 0)
+Computer_Club::Computer_Club(const std::string& filename, Input_Mode mode, Output_Sink& output,
+    const Checkpoint_Options& checkpoints, std::pmr::memory_resource* memory,
+    const Parse_Chunking& chunking)
+    : clients_(memory)
+    , tables_(memory)
+    , first_table_(1)
+    , waiting_list_(memory)
+    , start_time_(0, 0)
     , end_time_(0, 0)
+    , output_(output)
+    , pushed_events_(nullptr)
+    , events_offset_(0)
+    , last_event_time_(0, 0)
+    , occupancy_(nullptr)
+    , checkpoints_(checkpoints)
+    , events_since_checkpoint_(0)
+    , last_checkpoint_time_(0, 0)
+    , resumed_(false)
 {
     int num_of_tables;
     int cost_per_hour;
-    parse_input(filename, num_of_tables, start_time_, end_time_, cost_per_hour,
-        events_);
+    if (filename == "-") { // stdin can't be mapped, it is always streamed
+        parse_header(std::cin, num_of_tables, start_time_, end_time_, cost_per_hour);
+        events_ = std::make_unique<Stream_Event_Source>(std::cin, memory);
+    } else if (mode == Input_Mode::Live) {
+        input_file_ = open_input_file(filename);
+        parse_header(input_file_, num_of_tables, start_time_, end_time_, cost_per_hour);
+        std::streamoff header_size = input_file_.tellg(); // -1 if the header ends the file
+        events_offset_ = header_size < 0 ? std::filesystem::file_size(filename) : uint64_t(header_size);
+        auto pushed_events = std::make_unique<Line_Event_Source>(memory);
+        pushed_events_ = pushed_events.get();
+        events_ = std::move(pushed_events);
+    } else if (is_binary_log_file(filename)) { // pre-parsed, always read from the mapping
+        mapped_input_.emplace(filename);
+        parse_binary_header(mapped_input_->data(), num_of_tables, start_time_, end_time_, cost_per_hour);
+        events_ = std::make_unique<Binary_Event_Source>(mapped_input_->data(), memory);
+    } else if (mode == Input_Mode::Pipelined) {
+        input_file_ = open_input_file(filename);
+        parse_header(input_file_, num_of_tables, start_time_, end_time_, cost_per_hour);
+        std::streamoff header_size = input_file_.tellg(); // -1 if the header ends the file
+        events_offset_ = header_size < 0 ? std::filesystem::file_size(filename) : uint64_t(header_size);
+        input_file_.close();
+        events_ = std::make_unique<Pipelined_Event_Source>(filename, events_offset_, memory);
+    } else if (mode == Input_Mode::Memory_Mapped || mode == Input_Mode::Parallel_Parse) {
+        mapped_input_.emplace(filename);
+        std::string_view buffer = mapped_input_->data();
+        parse_header(buffer, num_of_tables, start_time_, end_time_, cost_per_hour);
+        size_t header_size = buffer.data() - mapped_input_->data().data();
+        if (mode == Input_Mode::Parallel_Parse) {
+            events_ = std::make_unique<Parallel_Event_Source>(mapped_input_->data(), header_size, chunking, memory);
+        } else {
+            events_ = std::make_unique<Buffer_Event_Source>(mapped_input_->data(), header_size, memory);
+        }
+    } else {
+        input_file_ = open_input_file(filename);
+        parse_header(input_file_, num_of_tables, start_time_, end_time_, cost_per_hour);
+        events_ = std::make_unique<Stream_Event_Source>(input_file_, memory);
+    }
 
     cost_per_hour_ = cost_per_hour;
+    events_->set_dated(start_time_.dated());
+
+    initialize_tables_(num_of_tables);
+    queue_capacity_ = size_t(num_of_tables);
+    last_checkpoint_time_ = start_time_;
 
+    if (checkpoints_.resume && std::filesystem::exists(checkpoints_.path)) {
+        restore_checkpoint_();
+    }
+}
+Computer_Club::Computer_Club(const Parsed_Log& log, const Club_Overrides& overrides, Output_Sink& output,
+    std::pmr::memory_resource* memory)
+    : clients_(memory)
+    , tables_(memory)
+    , first_table_(overrides.first_table.value_or(1))
+    , waiting_list_(memory)
+    , start_time_(log.start_time)
+    , end_time_(log.end_time)
+    , cost_per_hour_(overrides.cost_per_hour.value_or(log.cost_per_hour))
+    , output_(output)
+    , events_(overrides.events == nullptr ? std::make_unique<Parsed_Event_Source>(log, memory)
+                                          : std::make_unique<Parsed_Event_Source>(log, *overrides.events, memory))
+    , pushed_events_(nullptr)
+    , events_offset_(0)
+    , last_event_time_(0, 0)
+    , occupancy_(nullptr)
+    , events_since_checkpoint_(0)
+    , last_checkpoint_time_(log.start_time)
+    , resumed_(false)
+{
+    int num_of_tables = overrides.num_of_tables.value_or(log.num_of_tables);
     initialize_tables_(num_of_tables);
+    queue_capacity_ = size_t(std::max(overrides.queue_capacity.value_or(num_of_tables), 0));
 }
 void Computer_Club::simulate()
 {
-    process_events_(events_);
+    process_events_(*events_);
 }
 void Computer_Club::print_tables()
 {
-    for (const auto& table : tables_) {
-        std::cout << table << std::endl;
+    for (int i = 0; i < tables_.size(); ++i) {
+        Table row = tables_.row(i);
+        row.number += first_table_ - 1;
+        output_.write_table(row);
     }
 }
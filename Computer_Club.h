@@ -5,33 +5,121 @@
 #include <vector>
 #include <queue>
 #include <optional>
+#include <memory>
+#include <memory_resource>
+#include <fstream>
+#include <string_view>
 #include "Computer_Club_STRUCTS.h" // Time, Event, Client, Table
+#include "checkpoint.h"
+#include "instrumentation.h"
+#include "mapped_file.h"
+#include "parsing_functions.h" // Event_Source
+#include "output_sink.h"
+#include "parallel_parser.h" // Parse_Chunking
+
+enum class Input_Mode {
+    Stream, // std::ifstream (or stdin for "-"), read line by line
+    Memory_Mapped, // mmap'ed file, events point into the mapping
+    Pipelined, // read and lexed ahead on two more threads (see Pipelined_Event_Source)
+    Parallel_Parse, // mmap'ed file lexed on every core before simulating (see Parallel_Event_Source)
+    Live // only the header is read, events are pushed with ingest_line()
+};
+
+// what the club looks like right now, for live queries
+struct Club_Status {
+    Time last_event_time;
+    int free_tables;
+    size_t queue_length;
+    int clients_present;
+    std::vector<Table> tables; // revenue and time billed so far
+    std::vector<bool> occupied;
+};
+
+// What a club simulated from a Parsed_Log does differently from its header;
+// unset fields keep the header's values. queue_capacity is how many clients
+// may wait before the next one leaves instead (as many as there are tables
+// by default). A club that is one room of a venue (see run_rooms) numbers
+// its tables from first_table on and replays only the events of the log
+// listed in events.
+struct Club_Overrides {
+    std::optional<int> num_of_tables {};
+    std::optional<int> cost_per_hour {};
+    std::optional<int> queue_capacity {};
+    std::optional<int> first_table {};
+    const std::vector<size_t>* events = nullptr; // indexes into the log's events, all of them if null
+};
 
 class Computer_Club {
 private:
-    std::unordered_map<std::string, Client> clients_;
-    std::vector<Table> tables_;
-    std::queue<Client> waiting_list_;
-    Time start_time_;
+    std::pmr::vector<Client> clients_; // indexed by interned client ID
+    Table_Columns tables_;
+    int first_table_; // number of tables_[0]
+    Waiting_List waiting_list_;
+    Time start_time_; // of the current shift, the header's one in undated logs
     Time end_time_;
     int cost_per_hour_;
-    std::vector<Event> events_;
+    size_t queue_capacity_;
+    Output_Sink& output_;
+    std::ifstream input_file_;
+    std::optional<Mapped_File> mapped_input_;
+    std::unique_ptr<Event_Source> events_;
+    Line_Event_Source* pushed_events_; // events_ in live mode, else null
+    uint64_t events_offset_; // where the events start in the input file
+    Time last_event_time_;
+    Occupancy_Record* occupancy_; // null unless recording
+    [[no_unique_address]] Club_Metrics metrics_; // empty unless built with CLUB_INSTRUMENTATION
+    Checkpoint_Options checkpoints_;
+    uint64_t events_since_checkpoint_;
+    Time last_checkpoint_time_;
+    bool resumed_;
 
-    std::optional<Event> handle_client_arrival_(const Time& arrival_time, const std::string& event_body);
-    std::optional<Event> handle_client_sit_(const Time& event_time, const std::string& event_body);
-    std::optional<Event> handle_client_start_waiting_(const Time& event_time, const std::string& event_body);
-    std::optional<Event> handle_client_leave_table_(const Time& event_time, const std::string& event_body);
-    void handle_client_leave_(const Time& event_time, const std::string& event_body);
+    std::optional<Event_View> handle_client_arrival_(const Time& arrival_time, int client, std::string_view event_body);
+    std::optional<Event_View> handle_client_sit_(const Time& event_time, int client, int table_number, std::string_view event_body);
+    std::optional<Event_View> handle_client_start_waiting_(const Time& event_time, int client, std::string_view event_body);
+    std::optional<Event_View> handle_client_leave_table_(const Time& event_time, int client, std::string_view event_body);
+    void handle_client_leave_(const Time& event_time, int client);
 
-    std::optional<Event> handle_event_(Event& event);
-    void process_events_(std::vector<Event>& events);
+    std::optional<Event_View> handle_event_(const Event_View& event);
+    void process_event_(const Event_View& event);
+    void process_events_(Event_Source& events);
+    void free_table_(int table_index, const Time& event_time);
+    void close_day_();
+    void start_next_shift_(const Time& event_time);
     void initialize_tables_(int num_of_tables);
+    bool checkpoint_due_(const Time& event_time);
+    void save_checkpoint_(const Time& event_time);
+    void restore_checkpoint_();
 
 public:
-    Computer_Club(const std::string& filename);
+    // All state that grows with the log (names, clients, tables, the waiting
+    // list) is allocated from memory, which has to outlive the club. chunking
+    // is how a Parallel_Parse club splits its log.
+    Computer_Club(const std::string& filename, Input_Mode mode, Output_Sink& output,
+        const Checkpoint_Options& checkpoints = {},
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+        const Parse_Chunking& chunking = {});
+    // A club that replays log instead of reading a file; log has to outlive it.
+    Computer_Club(const Parsed_Log& log, const Club_Overrides& overrides, Output_Sink& output,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
     void simulate();
+    // true if the club picked up from a checkpoint: the output it writes then
+    // continues the output written (and flushed) before that checkpoint
+    bool resumed() const { return resumed_; }
+
+    // Live mode: handles one line as soon as it arrives. Returns false for a
+    // line that isn't an event (it is skipped, as in a log file); throws like
+    // the parser does for an invalid time or ID.
+    bool ingest_line(std::string_view line);
+    // everyone still in the club leaves, as at the end of simulate()
+    void close_day();
+    Club_Status status() const;
+    uint64_t events_offset() const { return events_offset_; }
+    const Club_Metrics& metrics() const { return metrics_; }
+    // from now on every freed table and every closed shift is added to record
+    void record_occupancy(Occupancy_Record* record) { occupancy_ = record; }
     Time get_start_time() const { return start_time_; }
     Time get_end_time() const { return end_time_; }
+    int get_num_of_tables() const { return tables_.size(); }
     void print_tables();
 };
 
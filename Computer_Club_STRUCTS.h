@@ -1,146 +1,478 @@
 #ifndef COMPUTER_CLUB_STRUCTS_H
 #define COMPUTER_CLUB_STRUCTS_H
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <deque>
 #include <iostream>
+#include <memory_resource>
 #include <queue>
-#include <regex>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+using Minutes = int64_t;
+
+constexpr Minutes minutes_per_day = 24 * 60;
+
+// Proleptic Gregorian calendar day number, 0001-01-01 being day 1 (as in
+// Python's date.toordinal()), and back. Day 0 is left for undated logs.
+constexpr int64_t ordinal_from_date(int64_t year, int month, int day)
+{
+    // days_from_civil by H. Hinnant, shifted from 1970-01-01 = 0
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468 + 719163;
+}
+constexpr void date_from_ordinal(int64_t ordinal, int64_t& year, int& month, int& day)
+{
+    int64_t days = ordinal - 719163 + 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t month_index = (5 * day_of_year + 2) / 153;
+    day = int(day_of_year - (153 * month_index + 2) / 5 + 1);
+    month = int(month_index < 10 ? month_index + 3 : month_index - 9);
+    year = year_of_era + era * 400 + (month <= 2);
+}
+
+// A point on the club's timeline (or a duration) as a single count of
+// minutes. Undated logs live on day 0, so their times are minutes of the day;
+// dated logs count from midnight of day 0 of the ordinal calendar above, so a
+// week or a month of shifts, overnight ones included, is one timeline.
 struct Time {
-    int hour;
-    int minute;
+    Minutes minutes;
 
-    Time(int h, int m)
-        : hour(h)
-        , minute(m)
+    constexpr Time()
+        : minutes(0)
     {
     }
 
-    bool operator<(const Time& other) const
+    constexpr Time(int h, int m)
+        : minutes(Minutes(h) * 60 + m)
     {
-        return hour < other.hour || (hour == other.hour && minute < other.minute);
     }
 
-    bool operator>(const Time& other) const
+    static constexpr Time from_minutes(Minutes m)
     {
-        return hour > other.hour || (hour == other.hour && minute > other.minute);
+        Time t;
+        t.minutes = m;
+        return t;
     }
 
-    bool operator==(const Time& other) const
-    {
-        return hour == other.hour && minute == other.minute;
-    }
+    // a duration's hours are not wrapped at a day
+    constexpr Minutes hour() const { return minutes / 60; }
+    constexpr int minute() const { return int(minutes % 60); }
 
-    bool operator<=(const Time& other) const
+    // for points on the timeline
+    constexpr int64_t day() const { return minutes / minutes_per_day; }
+    constexpr Time time_of_day() const { return from_minutes(minutes % minutes_per_day); }
+    constexpr bool dated() const { return minutes >= minutes_per_day; }
+
+    constexpr auto operator<=>(const Time& other) const = default;
+
+    constexpr Time operator+(const Time& other) const
     {
-        return *this < other || *this == other;
+        return from_minutes(minutes + other.minutes);
     }
 
-    bool operator>=(const Time& other) const
+    // Subtraction operation, durations never go negative
+    constexpr Time operator-(const Time& other) const
     {
-        return *this > other || *this == other;
+        return from_minutes(std::max(minutes - other.minutes, Minutes(0)));
     }
 
-    Time operator+(const Time& other) const
+    constexpr Time operator+=(const Time& other)
     {
-        int total_minutes = (hour * 60 + minute) + (other.hour * 60 + other.minute);
-        int new_hour = total_minutes / 60;
-        int new_minute = total_minutes % 60;
-        return { new_hour, new_minute };
+        minutes += other.minutes;
+        return *this;
     }
 
-    // Subtraction operation
-    Time operator-(const Time& other) const
+    // print time in HH:MM format, with the date first on a dated timeline
+    friend std::ostream& operator<<(std::ostream& os, const Time& t)
     {
-        int total_minutes = (hour * 60 + minute) - (other.hour * 60 + other.minute);
-        if (total_minutes < 0) {
-            total_minutes = 0;
+        Time time = t;
+        if (t.dated()) {
+            int64_t year;
+            int month;
+            int day;
+            date_from_ordinal(t.day(), year, month, day);
+            os << year << "-" << (month < 10 ? "0" : "") << month << "-" << (day < 10 ? "0" : "") << day << " ";
+            time = t.time_of_day();
         }
-        int new_hour = total_minutes / 60;
-        int new_minute = total_minutes % 60;
-        return { new_hour, new_minute };
+        os << (time.hour() < 10 ? "0" : "") << time.hour() << ":" << (time.minute() < 10 ? "0" : "") << time.minute();
+        return os;
     }
+};
+
+// ID of an event body that isn't a valid client name
+constexpr int no_client = -1;
+// table number of a body that isn't a valid sit body ("client1 4"), or whose
+// number doesn't fit in an int
+constexpr int no_table = -1;
+constexpr int table_overflow = -2;
 
-    Time operator+=(const Time& other)
+// Interns client names into dense IDs 0, 1, 2, ... so the simulation can keep
+// client state in flat arrays and never hash or compare names.
+// Names live in a deque, so the string_view keys stay valid as it grows.
+// Everything is allocated from memory (e.g. a run's Arena).
+struct Name_Table {
+    std::pmr::deque<std::pmr::string> names;
+    std::pmr::unordered_map<std::string_view, int> ids;
+
+    explicit Name_Table(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : names(memory)
+        , ids(memory)
     {
-        *this = *this + other;
-        return *this;
     }
+    Name_Table(const Name_Table&) = delete;
+    Name_Table& operator=(const Name_Table&) = delete;
+    Name_Table(Name_Table&&) = default;
+    // moving names into another resource would leave the keys pointing at the old copies
+    Name_Table& operator=(Name_Table&&) = delete;
 
-    // print time in HH:MM format
-    friend std::ostream& operator<<(std::ostream& os, const Time& t)
+    int intern(std::string_view name)
     {
-        os << (t.hour < 10 ? "0" : "") << t.hour << ":" << (t.minute < 10 ? "0" : "") << t.minute;
-        return os;
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        int id = int(names.size());
+        names.emplace_back(name);
+        ids.emplace(names.back(), id);
+        return id;
     }
+
+    std::string_view name(int id) const { return names[id]; }
+    size_t size() const { return names.size(); }
 };
 
+// state of a client slot, indexed by interned client ID
 struct Client {
-    std::string name;
+    bool present; // in the club right now
     bool seated;
     int table_number;
 
     Client()
-        : name("")
+        : present(false)
         , seated(false)
         , table_number(-1)
     {
     }
+};
 
-    Client(std::string n)
-        : name(n)
-        , seated(false)
-        , table_number(-1)
-    {
-    }
+// a stretch of time a table was occupied, recorded when it is freed, with
+// what it was billed for it
+struct Occupancy_Interval {
+    int table_index;
+    Minutes start;
+    Minutes end;
+    int revenue;
+};
+
+// what a recording club saw: its occupied intervals and the shifts (opening
+// and closing time) it was open for
+struct Occupancy_Record {
+    std::vector<Occupancy_Interval> intervals;
+    std::vector<std::pair<Time, Time>> shifts;
 };
 
+// one row of the end-of-day report
 struct Table {
     int number;
     int revenue;
-    bool occupied;
-    Time occupied_time_start;
-    Time occupied_time_end;
     Time total_occupied_time;
 
-    Table(int num)
+    Table(int num, int rev, Time total)
         : number(num)
-        , revenue(0)
-        , occupied(false)
-        , occupied_time_start(0, 0)
-        , occupied_time_end(0, 0)
-        , total_occupied_time(0, 0)
-    {
-    }
-
-    Table()
-        : number(0)
-        , revenue(0)
-        , occupied(false)
-        , occupied_time_start(0, 0)
-        , occupied_time_end(0, 0)
-        , total_occupied_time(0, 0)
+        , revenue(rev)
+        , total_occupied_time(total)
     {
     }
 
     // operator overloading for printing table info
     friend std::ostream& operator<<(std::ostream& os, const Table& t)
     {
-        os << t.number << " " << t.revenue << " " << t.total_occupied_time;
+        // a duration, hours past 23 are not a new day
+        Time time = t.total_occupied_time;
+        os << t.number << " " << t.revenue << " " << (time.hour() < 10 ? "0" : "") << time.hour() << ":"
+           << (time.minute() < 10 ? "0" : "") << time.minute();
         return os;
     }
 };
 
+// Bitset of free tables (bit i set = table i + 1 is free) plus a free counter,
+// so "is any table free" is O(1) and "first free table" is a find-first-set
+// over 64 tables at a time.
+struct Free_Table_Set {
+    std::pmr::vector<uint64_t> words;
+    int free_count;
+    size_t first_word; // no free table lives in a word before this one
+
+    explicit Free_Table_Set(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : words(memory)
+        , free_count(0)
+        , first_word(0)
+    {
+    }
+
+    // all tables start free
+    explicit Free_Table_Set(int num_of_tables, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : Free_Table_Set(memory)
+    {
+        reset(num_of_tables);
+    }
+
+    // in place, so the words stay in the same memory
+    void reset(int num_of_tables)
+    {
+        words.assign((num_of_tables + 63) / 64, ~uint64_t(0));
+        free_count = num_of_tables;
+        first_word = 0;
+        if (num_of_tables % 64 != 0) {
+            words.back() = (uint64_t(1) << (num_of_tables % 64)) - 1;
+        }
+    }
+
+    bool any() const { return free_count > 0; }
+
+    bool is_free(int table_index) const
+    {
+        return (words[table_index / 64] >> (table_index % 64)) & 1;
+    }
+
+    void mark_occupied(int table_index)
+    {
+        if (is_free(table_index)) {
+            words[table_index / 64] &= ~(uint64_t(1) << (table_index % 64));
+            --free_count;
+        }
+    }
+
+    void mark_free(int table_index)
+    {
+        if (!is_free(table_index)) {
+            words[table_index / 64] |= uint64_t(1) << (table_index % 64);
+            ++free_count;
+            first_word = std::min(first_word, size_t(table_index / 64));
+        }
+    }
+
+    // index of the lowest-numbered free table, -1 if all are taken
+    int first()
+    {
+        if (!any()) {
+            return -1;
+        }
+        while (words[first_word] == 0) {
+            ++first_word;
+        }
+        return int(first_word * 64) + std::countr_zero(words[first_word]);
+    }
+};
+
+// FIFO of waiting client IDs, kept as a ring buffer. Removing a client
+// tombstones all of its entries in O(1) (entries pushed before the client's
+// cutoff are dead) instead of rebuilding the queue; dead entries are dropped
+// when they reach the front.
+// Like the std::queue it replaces, a client may be queued more than once and
+// stays queued after leaving the club, until remove() is called.
+struct Waiting_List {
+    struct Entry {
+        int client;
+        uint64_t seq;
+    };
+
+    std::pmr::vector<uint64_t> removed_before; // per client: entries with a smaller seq are tombstones
+    std::pmr::vector<int> queued; // per client: live entries
+    std::pmr::vector<Entry> ring;
+    size_t head = 0; // index of the front entry in ring
+    size_t count = 0; // entries in ring, tombstones included
+    size_t live = 0; // entries that are not tombstones
+    uint64_t next_seq = 0;
+
+    explicit Waiting_List(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : removed_before(memory)
+        , queued(memory)
+        , ring(memory)
+    {
+    }
+
+    size_t size() const { return live; }
+    bool empty() const { return live == 0; }
+
+    void push(int client)
+    {
+        if (client >= int(queued.size())) {
+            queued.resize(client + 1, 0);
+            removed_before.resize(client + 1, 0);
+        }
+        if (count == ring.size()) {
+            grow_();
+        }
+        ring[(head + count) % ring.size()] = { client, next_seq++ };
+        ++count;
+        ++live;
+        ++queued[client];
+    }
+
+    // takes the first live client off the queue
+    int pop()
+    {
+        drop_tombstones_();
+        Entry entry = ring[head];
+        head = (head + 1) % ring.size();
+        --count;
+        --live;
+        --queued[entry.client];
+        return entry.client;
+    }
+
+    // live entries, front first; pushing them into an empty list rebuilds it
+    std::vector<int> clients() const
+    {
+        std::vector<int> live_clients;
+        live_clients.reserve(live);
+        for (size_t i = 0; i < count; ++i) {
+            const Entry& entry = ring[(head + i) % ring.size()];
+            if (!is_tombstone_(entry)) {
+                live_clients.push_back(entry.client);
+            }
+        }
+        return live_clients;
+    }
+
+    void remove(int client)
+    {
+        if (client >= int(queued.size()) || queued[client] == 0) {
+            return;
+        }
+        live -= queued[client];
+        queued[client] = 0;
+        removed_before[client] = next_seq;
+        if (count > 2 * live + 64) {
+            compact_();
+        }
+    }
+
+private:
+    bool is_tombstone_(const Entry& entry) const
+    {
+        return entry.seq < removed_before[entry.client];
+    }
+
+    void drop_tombstones_()
+    {
+        while (is_tombstone_(ring[head])) {
+            head = (head + 1) % ring.size();
+            --count;
+        }
+    }
+
+    void grow_()
+    {
+        std::pmr::vector<Entry> bigger(std::max<size_t>(16, ring.size() * 2), ring.get_allocator());
+        for (size_t i = 0; i < count; ++i) {
+            bigger[i] = ring[(head + i) % ring.size()];
+        }
+        ring.swap(bigger);
+        head = 0;
+    }
+
+    // tombstones stuck behind a long-waiting front client would pile up otherwise
+    void compact_()
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; ++i) {
+            Entry entry = ring[(head + i) % ring.size()];
+            if (!is_tombstone_(entry)) {
+                ring[(head + kept) % ring.size()] = entry;
+                ++kept;
+            }
+        }
+        count = kept;
+    }
+};
+
+// Tables stored column by column, index = table number - 1. Billing and
+// reporting only touch the columns they need, and the numeric columns are
+// plain arrays that loops over many tables can vectorize.
+struct Table_Columns {
+    Free_Table_Set free; // occupied tables have their bit cleared
+    std::pmr::vector<Minutes> start; // when the current client sat down
+    std::pmr::vector<Minutes> occupied_minutes;
+    std::pmr::vector<int> revenue;
+
+    explicit Table_Columns(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : free(memory)
+        , start(memory)
+        , occupied_minutes(memory)
+        , revenue(memory)
+    {
+    }
+
+    explicit Table_Columns(int num_of_tables, std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : Table_Columns(memory)
+    {
+        reset(num_of_tables);
+    }
+
+    // all tables free and unbilled, in place
+    void reset(int num_of_tables)
+    {
+        free.reset(num_of_tables);
+        start.assign(num_of_tables, 0);
+        occupied_minutes.assign(num_of_tables, 0);
+        revenue.assign(num_of_tables, 0);
+    }
+
+    int size() const { return int(start.size()); }
+    bool occupied(int table_index) const { return !free.is_free(table_index); }
+
+    Table row(int table_index) const
+    {
+        return { table_index + 1, revenue[table_index], Time::from_minutes(occupied_minutes[table_index]) };
+    }
+};
+
+// what a generated 13 event reports; its text is only put together when the
+// event is written out (see format_event)
+enum class Club_Error : uint8_t {
+    none,
+    invalid_client_name, // Invalid client name: <body>
+    you_shall_not_pass,
+    not_open_yet,
+    invalid_sit_body, // Error: invalid sit event body: <<body>>
+    table_out_of_range, // Error: table number <table> is out of range
+    place_is_busy,
+    client_unknown,
+    i_can_wait_no_longer,
+    client_seated, // Error: client <client> is happily seated ...
+    client_not_seated, // Error: client <client> is not seated
+    unknown_event_id,
+    after_closing_time,
+};
+
 struct Event {
     Time time;
     int ID;
     std::string body;
+    int client; // interned ID of the client named in body, or no_client
+    int table; // table number of a sit event (2, 12), decoded from body
 
-    Event(Time t, int id, std::string b)
+    Event(Time t, int id, std::string b, int c = no_client, int tb = no_table)
         : time(t)
         , ID(id)
         , body(b)
+        , client(c)
+        , table(tb)
     {
     }
 
@@ -152,4 +484,57 @@ struct Event {
     }
 };
 
+// non-owning Event, the body points into an input buffer (e.g. a mapped file).
+// Events the club generates (11, 12, 13) are typed: they carry no text of
+// their own, only the client, table or error, and are rendered when written
+// out. The body of a generated 13 is the input body it quotes, if any.
+struct Event_View {
+    Time time;
+    int ID;
+    std::string_view body;
+    int client;
+    int table;
+    Club_Error error;
+    bool generated;
+
+    Event_View(Time t, int id, std::string_view b, int c = no_client, int tb = no_table)
+        : time(t)
+        , ID(id)
+        , body(b)
+        , client(c)
+        , table(tb)
+        , error(Club_Error::none)
+        , generated(false)
+    {
+    }
+
+    Event_View(const Event& e)
+        : Event_View(e.time, e.ID, e.body, e.client, e.table)
+    {
+    }
+
+    // 11 (client leaves) or 12 (client sits at table)
+    static Event_View generated_event(Time t, int id, int c, int tb = no_table)
+    {
+        Event_View event(t, id, {}, c, tb);
+        event.generated = true;
+        return event;
+    }
+
+    static Event_View error_event(Time t, Club_Error error, std::string_view quoted = {}, int c = no_client, int tb = no_table)
+    {
+        Event_View event(t, 13, quoted, c, tb);
+        event.error = error;
+        event.generated = true;
+        return event;
+    }
+
+    // input events only, generated ones need the names (see format_event)
+    friend std::ostream& operator<<(std::ostream& os, const Event_View& e)
+    {
+        os << e.time << " " << e.ID << " " << e.body;
+        return os;
+    }
+};
+
 #endif // COMPUTER_CLUB_STRUCTS_H
@@ -0,0 +1,60 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+#include <new>
+
+Arena::Arena()
+    : used_(0)
+{
+}
+Arena::~Arena()
+{
+    free_blocks_();
+}
+void Arena::add_block_(size_t size)
+{
+    auto* data = static_cast<std::byte*>(::operator new(size, std::align_val_t(block_alignment)));
+    blocks_.push_back({ data, size });
+    used_ = 0;
+}
+void Arena::free_blocks_()
+{
+    for (const Block& block : blocks_) {
+        ::operator delete(block.data, block.size, std::align_val_t(block_alignment));
+    }
+    blocks_.clear();
+}
+void* Arena::do_allocate(size_t bytes, size_t alignment)
+{
+    if (!blocks_.empty()) {
+        Block& block = blocks_.back();
+        uintptr_t next = reinterpret_cast<uintptr_t>(block.data) + used_;
+        size_t padding = (alignment - next % alignment) % alignment;
+        if (used_ + padding + bytes <= block.size) {
+            used_ += padding + bytes;
+            return block.data + (used_ - bytes);
+        }
+    }
+
+    // blocks double, so a growing run needs only a few of them
+    size_t last_size = blocks_.empty() ? 0 : blocks_.back().size;
+    add_block_(std::max({ min_block_size, 2 * last_size, bytes + alignment }));
+    return do_allocate(bytes, alignment);
+}
+void Arena::reset()
+{
+    if (blocks_.size() > 1) {
+        size_t total = capacity();
+        free_blocks_();
+        add_block_(total);
+    }
+    used_ = 0;
+}
+size_t Arena::capacity() const
+{
+    size_t total = 0;
+    for (const Block& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
@@ -0,0 +1,45 @@
+#ifndef RECRUITMENT_TEST_ARENA_H
+#define RECRUITMENT_TEST_ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for everything one club run allocates (names, client slots,
+// table columns, the waiting list): allocating moves a pointer, deallocating
+// does nothing, and reset() takes it all back at once. The memory is kept,
+// merged into a single block as big as the run needed, so a thread that runs
+// club after club stops calling malloc once it has seen its biggest run.
+// Not thread-safe: one arena per thread.
+class Arena : public std::pmr::memory_resource {
+private:
+    static constexpr size_t min_block_size = 64 * 1024;
+    static constexpr size_t block_alignment = 64;
+
+    struct Block {
+        std::byte* data;
+        size_t size;
+    };
+    std::vector<Block> blocks_; // the last one is being allocated from
+    size_t used_; // bytes taken from the last block
+
+    void add_block_(size_t size);
+    void free_blocks_();
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override { }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    Arena();
+    ~Arena() override;
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // everything allocated so far is gone; nothing may still use it
+    void reset();
+    size_t capacity() const;
+};
+
+#endif // RECRUITMENT_TEST_ARENA_H
@@ -0,0 +1,98 @@
+#include "batch_runner.h"
+#include "arena.h"
+#include "multi_room.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+
+bool run_club(const std::string& filename, Input_Mode mode, Output_Sink& output,
+    const Checkpoint_Options& checkpoints, std::pmr::memory_resource* memory, const Index_Options& index,
+    const Parse_Chunking& chunking)
+{
+    if (filename != "-" && is_multi_room_log_file(filename)) {
+        if (!checkpoints.path.empty() || !index.path.empty()) {
+            output.write_line("Error: checkpoints and occupancy indexes are for single-room logs");
+            return false;
+        }
+        return run_rooms(filename, output);
+    }
+    try {
+        Computer_Club club(filename, mode, output, checkpoints, memory, chunking);
+        Occupancy_Record occupancy;
+        if (!index.path.empty()) {
+            club.record_occupancy(&occupancy);
+        }
+
+        if (!club.resumed()) {
+            output.write_time(club.get_start_time());
+        }
+        club.simulate();
+        output.write_time(club.get_end_time());
+        club.print_tables();
+        if (!index.path.empty()) {
+            Occupancy_Index(occupancy, club.get_num_of_tables(), index.bucket_minutes).save(index.path);
+        }
+        report_metrics(club.metrics());
+    } catch (const std::exception& e) {
+        output.write_line(e.what());
+        return false;
+    }
+    return true;
+}
+std::vector<std::string> collect_batch_inputs(const std::vector<std::string>& paths)
+{
+    if (paths.size() != 1 || !std::filesystem::is_directory(paths[0])) {
+        return paths;
+    }
+
+    std::vector<std::string> filenames;
+    for (const auto& entry : std::filesystem::directory_iterator(paths[0])) {
+        if (entry.is_regular_file()) {
+            filenames.push_back(entry.path().string());
+        }
+    }
+    std::sort(filenames.begin(), filenames.end());
+    return filenames;
+}
+int run_batch(const std::vector<std::string>& filenames, Input_Mode mode,
+    size_t num_of_threads, Output_Sink& output)
+{
+    std::vector<std::string> reports(filenames.size());
+    std::vector<char> done(filenames.size(), false);
+    int failed = 0;
+    std::mutex mutex;
+    std::condition_variable report_done;
+
+    Thread_Pool pool(num_of_threads);
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        pool.submit([&, i] {
+            thread_local Arena arena;
+            Memory_Sink report;
+            bool ok = run_club(filenames[i], mode, report, {}, &arena);
+            arena.reset();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            reports[i] = report.take();
+            done[i] = true;
+            failed += ok ? 0 : 1;
+            report_done.notify_one();
+        });
+    }
+
+    // write reports in input order while later clubs are still running
+    for (size_t i = 0; i < filenames.size(); ++i) {
+        std::string report;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            report_done.wait(lock, [&] { return bool(done[i]); });
+            report = std::move(reports[i]);
+        }
+        output.write_line("== " + filenames[i] + " ==");
+        output.write(report);
+    }
+
+    pool.wait();
+    return failed;
+}
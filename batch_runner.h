@@ -0,0 +1,37 @@
+#ifndef RECRUITMENT_TEST_BATCH_RUNNER_H
+#define RECRUITMENT_TEST_BATCH_RUNNER_H
+
+#include <string>
+#include <vector>
+#include "Computer_Club.h"
+#include "occupancy_index.h"
+#include "output_sink.h"
+
+// Simulates one club and writes its full report to output. On a parse error
+// the error message is written instead and false is returned.
+// A club resumed from a checkpoint writes only the part of the report that
+// follows the checkpoint. The club's state is allocated from memory.
+// With an index path the club's occupancy index is written there at the end.
+// chunking is how a Parallel_Parse club splits its log.
+// A multi-room log is simulated room by room instead (see run_rooms), in any
+// input mode.
+bool run_club(const std::string& filename, Input_Mode mode, Output_Sink& output,
+    const Checkpoint_Options& checkpoints = {},
+    std::pmr::memory_resource* memory = std::pmr::get_default_resource(),
+    const Index_Options& index = {},
+    const Parse_Chunking& chunking = {});
+
+// Input files for a batch: a single directory expands to the regular files in
+// it, sorted by name; anything else is taken as a list of files.
+std::vector<std::string> collect_batch_inputs(const std::vector<std::string>& paths);
+
+// Simulates every club on a work-stealing thread pool. Each report is
+// buffered per club and written to output under a "== <file> ==" header, in
+// the order of filenames, as soon as it and all reports before it are done.
+// Every worker thread allocates its clubs from its own Arena, reset after
+// each club, so workers don't contend on the heap.
+// Returns the number of clubs that failed.
+int run_batch(const std::vector<std::string>& filenames, Input_Mode mode,
+    size_t num_of_threads, Output_Sink& output);
+
+#endif // RECRUITMENT_TEST_BATCH_RUNNER_H
@@ -0,0 +1,151 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include "../Computer_Club.h"
+#include "../arena.h"
+#include "../helper_functions.h"
+#include "../parsing_functions.h"
+#include "../tools/log_generator.h"
+
+namespace {
+Log_Generator_Options bench_options(uint64_t events)
+{
+    Log_Generator_Options options;
+    options.seed = 42;
+    options.tables = 50;
+    options.clients = 500;
+    options.events = events;
+    return options;
+}
+
+// generated once per size and kept on disk for the whole run
+const std::string& bench_log_file(uint64_t events)
+{
+    static std::mutex mutex; // benchmarks run on several threads ask too
+    static std::map<uint64_t, std::string> files;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(events);
+    if (it == files.end()) {
+        std::string filename = (std::filesystem::temp_directory_path()
+            / ("bench_computer_club_" + std::to_string(events) + ".txt"))
+                                   .string();
+        std::ofstream(filename, std::ios::binary) << generate_log(bench_options(events));
+        it = files.emplace(events, filename).first;
+    }
+    return it->second;
+}
+}
+
+static void BM_ParseTime(benchmark::State& state)
+{
+    const std::string times[] = { "09:00", "23:59", "7:05", "12:30" };
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parse_time(times[i++ % 4]));
+    }
+}
+BENCHMARK(BM_ParseTime);
+
+static void BM_IsValidClientName(benchmark::State& state)
+{
+    std::string name(state.range(0), 'a');
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(is_valid_client_name(name));
+    }
+}
+BENCHMARK(BM_IsValidClientName)->Arg(8)->Arg(64)->Arg(1024);
+
+static void BM_ParseEvents(benchmark::State& state)
+{
+    std::string log = generate_log(bench_options(state.range(0)));
+    log = log.substr(log.find('\n', log.find('\n', log.find('\n') + 1) + 1) + 1); // events only
+    for (auto _ : state) {
+        std::istringstream input(log);
+        benchmark::DoNotOptimize(parse_events(input));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * int64_t(log.size()));
+}
+BENCHMARK(BM_ParseEvents)->Arg(1 << 10)->Arg(1 << 16);
+
+static void BM_RemoveClientFromQueue(benchmark::State& state)
+{
+    std::queue<int> waiting_list;
+    for (int i = 0; i < state.range(0); ++i) {
+        waiting_list.push(i);
+    }
+    for (auto _ : state) {
+        waiting_list = remove_client_from_queue(waiting_list, int(state.range(0) / 2));
+        waiting_list.push(int(state.range(0) / 2));
+    }
+}
+BENCHMARK(BM_RemoveClientFromQueue)->Arg(16)->Arg(1024);
+
+static void BM_WaitingListRemove(benchmark::State& state)
+{
+    Waiting_List waiting_list;
+    for (int i = 0; i < state.range(0); ++i) {
+        waiting_list.push(i);
+    }
+    for (auto _ : state) {
+        waiting_list.remove(int(state.range(0) / 2));
+        waiting_list.push(int(state.range(0) / 2));
+    }
+}
+BENCHMARK(BM_WaitingListRemove)->Arg(16)->Arg(1024);
+
+static void BM_Simulate(benchmark::State& state)
+{
+    const std::string& filename = bench_log_file(state.range(0));
+    constexpr Input_Mode modes[] = { Input_Mode::Stream, Input_Mode::Memory_Mapped, Input_Mode::Pipelined };
+    constexpr const char* labels[] = { "stream", "mmap", "pipelined" };
+    for (auto _ : state) {
+        Null_Sink output;
+        Computer_Club club(filename, modes[state.range(1)], output);
+        club.simulate();
+        club.print_tables();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetLabel(labels[state.range(1)]);
+}
+BENCHMARK(BM_Simulate)->Args({ 1 << 16, 0 })->Args({ 1 << 16, 1 })->Args({ 1 << 20, 1 })->Args({ 1 << 20, 2 })->Unit(benchmark::kMillisecond);
+
+static void BM_SimulateWithOutput(benchmark::State& state)
+{
+    const std::string& filename = bench_log_file(state.range(0));
+    for (auto _ : state) {
+        Memory_Sink output;
+        Computer_Club club(filename, Input_Mode::Memory_Mapped, output);
+        club.simulate();
+        club.print_tables();
+        benchmark::DoNotOptimize(output.str().data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimulateWithOutput)->Arg(1 << 16)->Unit(benchmark::kMillisecond);
+
+static void BM_SimulateSmallClubs(benchmark::State& state)
+{
+    // short days one after another, the way a batch worker runs them
+    const std::string& filename = bench_log_file(1 << 10);
+    Arena arena;
+    std::pmr::memory_resource* memory = state.range(0) ? &arena : std::pmr::get_default_resource();
+    for (auto _ : state) {
+        Null_Sink output;
+        {
+            Computer_Club club(filename, Input_Mode::Memory_Mapped, output, {}, memory);
+            club.simulate();
+            club.print_tables();
+        }
+        arena.reset();
+    }
+    state.SetItemsProcessed(state.iterations() * (1 << 10));
+    state.SetLabel(state.range(0) ? "arena" : "heap");
+}
+BENCHMARK(BM_SimulateSmallClubs)->Arg(0)->Arg(1)->Threads(1)->Threads(8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,292 @@
+#include "binary_log.h"
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+constexpr size_t max_int_digits = 11; // -2147483648
+
+void put_varint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(char(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(char(value));
+}
+void put_bytes(std::string& out, std::string_view bytes)
+{
+    put_varint(out, bytes.size());
+    out.append(bytes);
+}
+template <typename T>
+void put_le(std::string& out, T value)
+{
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(char((bits >> (8 * i)) & 0xFF));
+    }
+}
+template <typename T>
+T get_le(std::string_view input, size_t offset)
+{
+    std::make_unsigned_t<T> bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bits |= std::make_unsigned_t<T>(static_cast<unsigned char>(input[offset + i])) << (8 * i);
+    }
+    return static_cast<T>(bits);
+}
+
+[[noreturn]] void throw_corrupt()
+{
+    throw std::runtime_error("Error: binary log is corrupt");
+}
+uint64_t get_varint(std::string_view input, size_t& offset, size_t end)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (offset >= end) {
+            throw_corrupt();
+        }
+        unsigned char byte = static_cast<unsigned char>(input[offset++]);
+        value |= uint64_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw_corrupt();
+}
+std::string_view get_bytes(std::string_view input, size_t& offset, size_t end)
+{
+    uint64_t size = get_varint(input, offset, end);
+    if (size > end - offset) {
+        throw_corrupt();
+    }
+    std::string_view bytes = input.substr(offset, size);
+    offset += size;
+    return bytes;
+}
+
+// small negative numbers stay short too
+uint64_t zigzag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+int64_t unzigzag(uint64_t value)
+{
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+void put_tag(std::string& out, int ID, Record_Kind kind)
+{
+    put_varint(out, (uint64_t(ID) << 2) | uint64_t(kind));
+}
+
+// 'client1 4' as the sit record would rebuild it, so only such bodies use one
+bool is_canonical_sit_body(std::string_view body, std::string_view client_name, int table_number)
+{
+    char digits[max_int_digits];
+    char* end = std::to_chars(digits, digits + sizeof(digits), table_number).ptr;
+    return body.size() == client_name.size() + 1 + size_t(end - digits)
+        && body.substr(0, client_name.size()) == client_name
+        && body[client_name.size()] == ' '
+        && body.substr(client_name.size() + 1) == std::string_view(digits, end - digits);
+}
+void put_record(std::string& out, const Event_View& event, const Name_Table& names, Minutes first_day)
+{
+    put_varint(out, zigzag(event.time.minutes - first_day));
+    bool named_body = event.ID == 1 || event.ID == 3 || event.ID == 4 || event.ID == 11;
+    bool sit_body = event.ID == 2 || event.ID == 12;
+    if (event.client != no_client && named_body) {
+        put_tag(out, event.ID, Record_Kind::named);
+        put_varint(out, uint64_t(event.client));
+    } else if (event.client != no_client && sit_body && event.table >= 0
+        && is_canonical_sit_body(event.body, names.name(event.client), event.table)) {
+        put_tag(out, event.ID, Record_Kind::sit);
+        put_varint(out, uint64_t(event.client));
+        put_varint(out, uint64_t(event.table));
+    } else {
+        put_tag(out, event.ID, Record_Kind::raw);
+        put_bytes(out, event.body);
+    }
+}
+}
+
+bool is_binary_log(std::string_view input)
+{
+    return input.size() >= sizeof(binary_log_magic)
+        && input.substr(0, sizeof(binary_log_magic)) == std::string_view(binary_log_magic, sizeof(binary_log_magic));
+}
+bool is_binary_log_file(const std::string& filename)
+{
+    std::ifstream input_file(filename, std::ios::binary);
+    char magic[sizeof(binary_log_magic)] = {};
+    input_file.read(magic, sizeof(magic));
+    return input_file && is_binary_log(std::string_view(magic, sizeof(magic)));
+}
+void parse_binary_header(std::string_view input, int& num_of_tables, Time& start_time, Time& end_time, int& cost_per_hour)
+{
+    if (!is_binary_log(input) || input.size() < binary_log_header_size) {
+        throw std::runtime_error("Error: not a binary log");
+    }
+    if (get_le<uint32_t>(input, 8) != binary_log_version) {
+        throw std::runtime_error("Error: unsupported binary log version");
+    }
+    num_of_tables = get_le<int32_t>(input, 12);
+    start_time = Time::from_minutes(get_le<int64_t>(input, 16));
+    end_time = Time::from_minutes(get_le<int64_t>(input, 24));
+    cost_per_hour = get_le<int32_t>(input, 32);
+}
+void convert_to_binary_log(std::istream& text_log, std::ostream& binary_log)
+{
+    int num_of_tables;
+    Time start_time(0, 0);
+    Time end_time(0, 0);
+    int cost_per_hour;
+    parse_header(text_log, num_of_tables, start_time, end_time, cost_per_hour);
+
+    std::string header;
+    header.append(binary_log_magic, sizeof(binary_log_magic));
+    put_le(header, binary_log_version);
+    put_le(header, int32_t(num_of_tables));
+    put_le(header, start_time.minutes);
+    put_le(header, end_time.minutes);
+    put_le(header, int32_t(cost_per_hour));
+    put_le(header, uint32_t(0)); // reserved
+    put_le(header, uint64_t(0)); // offset of the string table, patched below
+    binary_log.write(header.data(), std::streamsize(header.size()));
+
+    constexpr size_t chunk_size = 64 * 1024;
+    uint64_t strings_offset = header.size();
+    std::string chunk;
+    auto write_chunk = [&]() {
+        binary_log.write(chunk.data(), std::streamsize(chunk.size()));
+        strings_offset += chunk.size();
+        chunk.clear();
+    };
+
+    Stream_Event_Source events(text_log);
+    events.set_dated(start_time.dated());
+    Minutes first_day = start_time.day() * minutes_per_day;
+    Event_View event(Time(0, 0), 0, {});
+    try {
+        while (events.next(event)) {
+            put_record(chunk, event, events.names(), first_day);
+            if (chunk.size() >= chunk_size) {
+                write_chunk();
+            }
+        }
+    } catch (const std::exception& e) {
+        // the text run stops with this message, so does the binary one
+        put_varint(chunk, 0);
+        put_tag(chunk, 0, Record_Kind::error);
+        put_bytes(chunk, e.what());
+    }
+    write_chunk();
+
+    const Name_Table& names = events.names();
+    put_varint(chunk, names.size());
+    for (size_t id = 0; id < names.size(); ++id) {
+        put_bytes(chunk, names.name(int(id)));
+    }
+    binary_log.write(chunk.data(), std::streamsize(chunk.size()));
+
+    std::string offset;
+    put_le(offset, strings_offset);
+    binary_log.seekp(std::streamoff(header.size() - sizeof(uint64_t)));
+    binary_log.write(offset.data(), std::streamsize(offset.size()));
+    binary_log.flush();
+    if (!binary_log) {
+        throw std::runtime_error("Error: cannot write binary log");
+    }
+}
+void convert_to_binary_log(const std::string& text_filename, const std::string& binary_filename)
+{
+    std::ifstream text_log = open_input_file(text_filename);
+    std::ofstream binary_log(binary_filename, std::ios::binary | std::ios::trunc);
+    if (!binary_log.is_open()) {
+        throw std::runtime_error("Error: cannot open output file <" + binary_filename + ">");
+    }
+    try {
+        convert_to_binary_log(text_log, binary_log);
+    } catch (...) {
+        binary_log.close();
+        std::remove(binary_filename.c_str());
+        throw;
+    }
+}
+
+Binary_Event_Source::Binary_Event_Source(std::string_view input, std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , input_(input)
+    , records_end_(0)
+    , next_(binary_log_header_size)
+    , first_day_(0)
+{
+    int num_of_tables;
+    Time start_time(0, 0);
+    Time end_time(0, 0);
+    int cost_per_hour;
+    parse_binary_header(input_, num_of_tables, start_time, end_time, cost_per_hour);
+    first_day_ = start_time.day() * minutes_per_day;
+
+    uint64_t strings_offset = get_le<uint64_t>(input_, binary_log_header_size - sizeof(uint64_t));
+    if (strings_offset < binary_log_header_size || strings_offset > input_.size()) {
+        throw_corrupt();
+    }
+    records_end_ = size_t(strings_offset);
+
+    size_t offset = records_end_;
+    uint64_t num_of_names = get_varint(input_, offset, input_.size());
+    for (uint64_t id = 0; id < num_of_names; ++id) {
+        names_.intern(get_bytes(input_, offset, input_.size()));
+    }
+}
+bool Binary_Event_Source::next(Event_View& event)
+{
+    if (next_ >= records_end_) {
+        return false;
+    }
+
+    event.time = Time::from_minutes(first_day_ + unzigzag(get_varint(input_, next_, records_end_)));
+    uint64_t tag = get_varint(input_, next_, records_end_);
+    event.ID = int(tag >> 2);
+    event.client = no_client;
+    event.table = no_table;
+
+    switch (Record_Kind(tag & 3)) {
+    case Record_Kind::named:
+    case Record_Kind::sit: {
+        uint64_t client = get_varint(input_, next_, records_end_);
+        if (client >= names_.size()) {
+            throw_corrupt();
+        }
+        event.client = int(client);
+        event.body = names_.name(event.client);
+        if (Record_Kind(tag & 3) == Record_Kind::sit) {
+            event.table = int(get_varint(input_, next_, records_end_));
+            body_.assign(event.body);
+            body_.push_back(' ');
+            char digits[max_int_digits];
+            body_.append(digits, std::to_chars(digits, digits + sizeof(digits), event.table).ptr);
+            event.body = body_;
+        }
+        break;
+    }
+    case Record_Kind::raw:
+        event.body = get_bytes(input_, next_, records_end_);
+        decode_body_(event);
+        break;
+    case Record_Kind::error:
+        throw std::runtime_error(std::string(get_bytes(input_, next_, records_end_)));
+    }
+    return true;
+}
+void Binary_Event_Source::seek(uint64_t offset)
+{
+    if (offset < binary_log_header_size || offset > records_end_) {
+        throw std::runtime_error("Error: position is outside the binary log's records");
+    }
+    next_ = size_t(offset);
+}
@@ -0,0 +1,69 @@
+#ifndef RECRUITMENT_TEST_BINARY_LOG_H
+#define RECRUITMENT_TEST_BINARY_LOG_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "Computer_Club_STRUCTS.h" // Time, Event_View, Name_Table
+#include "parsing_functions.h" // Event_Source
+
+// A pre-parsed log, so archived days can be replayed without lexing them again.
+//
+//   header   magic, version, table count, opening and closing minute (64-bit,
+//            on the log's timeline), price, a reserved word and the offset of
+//            the string table; fixed width, little endian
+//   records  one per event, up to the string table:
+//              zigzag varint minute, counted from midnight of the opening
+//              day (the minute of day in undated logs)
+//              varint (ID << 2 | kind), then by kind
+//              named: varint name  - body is the client name
+//              sit:   varint name, varint table  - body is 'name table'
+//              raw:   varint size, body bytes  - any other body
+//              error: varint size, message  - the text log failed to parse here
+//   strings  varint count, then varint size and bytes of each client name,
+//            in interning order
+//
+// Lines the text parser skips are dropped, and an error ends the records,
+// just as it ends a text run.
+constexpr char binary_log_magic[8] = { 'C', 'L', 'U', 'B', 'L', 'O', 'G', '\0' };
+constexpr uint32_t binary_log_version = 2; // 2: 64-bit minutes, dated logs
+constexpr size_t binary_log_header_size = 8 + 4 * 3 + 8 * 2 + 4 + 8;
+
+enum class Record_Kind : uint8_t {
+    named = 0,
+    sit = 1,
+    raw = 2,
+    error = 3,
+};
+
+bool is_binary_log(std::string_view input);
+bool is_binary_log_file(const std::string& filename);
+
+void parse_binary_header(std::string_view input, int& num_of_tables,
+    Time& start_time, Time& end_time, int& cost_per_hour);
+
+// Converts a text log. The output has to be seekable, the header is patched
+// once the position of the string table is known. Header errors are thrown.
+void convert_to_binary_log(std::istream& text_log, std::ostream& binary_log);
+void convert_to_binary_log(const std::string& text_filename, const std::string& binary_filename);
+
+// Reads records straight out of a binary log in memory (e.g. a Mapped_File).
+// All client names are interned up front from the string table.
+class Binary_Event_Source : public Event_Source {
+private:
+    std::string_view input_;
+    size_t records_end_;
+    size_t next_; // offset of the next record
+    Minutes first_day_; // what record minutes count from
+    std::string body_; // 'name table' bodies are put together here
+
+public:
+    explicit Binary_Event_Source(std::string_view input,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    bool next(Event_View& event) override;
+    uint64_t position() override { return next_; }
+    void seek(uint64_t offset) override;
+};
+
+#endif // RECRUITMENT_TEST_BINARY_LOG_H
@@ -0,0 +1,93 @@
+#include "checkpoint.h"
+#include <cerrno>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <filesystem>
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+Snapshot_Writer::Snapshot_Writer()
+{
+    bytes_.append(checkpoint_magic, sizeof(checkpoint_magic));
+    put(checkpoint_version);
+}
+void Snapshot_Writer::put_string(std::string_view text)
+{
+    put(uint32_t(text.size()));
+    bytes_.append(text);
+}
+
+Snapshot_Reader::Snapshot_Reader(std::string_view bytes)
+    : bytes_(bytes)
+{
+    if (bytes_.size() < sizeof(checkpoint_magic)
+        || bytes_.substr(0, sizeof(checkpoint_magic)) != std::string_view(checkpoint_magic, sizeof(checkpoint_magic))) {
+        throw std::runtime_error("Error: not a checkpoint file");
+    }
+    bytes_.remove_prefix(sizeof(checkpoint_magic));
+    if (get<uint32_t>() != checkpoint_version) {
+        throw std::runtime_error("Error: unsupported checkpoint version");
+    }
+}
+std::string_view Snapshot_Reader::take_(size_t size)
+{
+    if (size > bytes_.size()) {
+        throw std::runtime_error("Error: checkpoint is truncated");
+    }
+    std::string_view taken = bytes_.substr(0, size);
+    bytes_.remove_prefix(size);
+    return taken;
+}
+std::string_view Snapshot_Reader::get_string()
+{
+    uint32_t size = get<uint32_t>();
+    return take_(size);
+}
+
+#ifdef _WIN32
+void write_file_atomically(const std::string& path, std::string_view bytes)
+{
+    std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream output_file(temporary_path, std::ios::binary | std::ios::trunc);
+        output_file.write(bytes.data(), std::streamsize(bytes.size()));
+        if (!output_file) {
+            throw std::runtime_error("Error: cannot write file <" + temporary_path + ">");
+        }
+    }
+    std::filesystem::rename(temporary_path, path);
+}
+#else
+void write_file_atomically(const std::string& path, std::string_view bytes)
+{
+    std::string temporary_path = path + ".tmp";
+    int fd = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Error: cannot write file <" + temporary_path + ">");
+    }
+    while (!bytes.empty()) {
+        ssize_t result = write(fd, bytes.data(), bytes.size());
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            close(fd);
+            throw std::runtime_error("Error: cannot write file <" + temporary_path + ">");
+        }
+        bytes.remove_prefix(size_t(result));
+    }
+    // the data has to be on disk before the rename puts it in place
+    if (fsync(fd) != 0) {
+        close(fd);
+        throw std::runtime_error("Error: cannot write file <" + temporary_path + ">");
+    }
+    close(fd);
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Error: cannot replace file <" + path + ">");
+    }
+}
+#endif
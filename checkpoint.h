@@ -0,0 +1,98 @@
+#ifndef RECRUITMENT_TEST_CHECKPOINT_H
+#define RECRUITMENT_TEST_CHECKPOINT_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "Computer_Club_STRUCTS.h" // Minutes
+
+// When a club writes checkpoints of its state while simulating. A checkpoint
+// is taken after the event that makes one due (and everything it generated)
+// is handled; each one replaces the previous one at path.
+struct Checkpoint_Options {
+    std::string path; // empty: no checkpoints
+    uint64_t every_events = 0; // 0: not by event count
+    Minutes every_minutes = 0; // of club time, 0: not by time
+    bool resume = false; // continue from the checkpoint at path, if there is one
+};
+
+// Checkpoint files start with this and a format version. Numbers are stored
+// in the byte order of the machine that wrote them, the magic doubles as a
+// check that the reader agrees on it.
+constexpr char checkpoint_magic[8] = { 'C', 'L', 'U', 'B', 'C', 'K', 'P', 'T' };
+constexpr uint32_t checkpoint_version = 2; // 2: 64-bit minutes, the current shift
+
+// Appends fixed-size values and length-prefixed arrays to a byte string.
+class Snapshot_Writer {
+private:
+    std::string bytes_;
+
+public:
+    Snapshot_Writer();
+
+    template <typename T>
+    void put(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T, typename Allocator>
+    void put_array(const std::vector<T, Allocator>& values)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        put(uint64_t(values.size()));
+        bytes_.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void put_string(std::string_view text);
+
+    const std::string& bytes() const { return bytes_; }
+};
+
+// Reads back what Snapshot_Writer wrote, throwing on a truncated or foreign file.
+class Snapshot_Reader {
+private:
+    std::string_view bytes_;
+
+    std::string_view take_(size_t size);
+
+public:
+    explicit Snapshot_Reader(std::string_view bytes);
+
+    template <typename T>
+    T get()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, take_(sizeof(T)).data(), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> get_array()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        uint64_t size = get<uint64_t>();
+        if (size > bytes_.size() / sizeof(T)) {
+            throw std::runtime_error("Error: checkpoint is truncated");
+        }
+        std::vector<T> values(size);
+        std::memcpy(values.data(), take_(size * sizeof(T)).data(), size * sizeof(T));
+        return values;
+    }
+
+    std::string_view get_string();
+
+    bool at_end() const { return bytes_.empty(); }
+};
+
+// Writes bytes to a temporary file next to path, syncs it and renames it over
+// path, so path always holds either the old or the new contents in full.
+void write_file_atomically(const std::string& path, std::string_view bytes);
+
+#endif // RECRUITMENT_TEST_CHECKPOINT_H
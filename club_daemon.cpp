@@ -0,0 +1,410 @@
+#include "club_daemon.h"
+#include "Computer_Club.h"
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+void Latency_Stats::record(uint64_t ns)
+{
+    ++count;
+    total_ns += ns;
+    max_ns = std::max(max_ns, ns);
+    ++buckets[std::bit_width(ns | 1) - 1];
+}
+double Latency_Stats::average_us() const
+{
+    return count == 0 ? 0.0 : double(total_ns) / double(count) / 1000.0;
+}
+double Latency_Stats::percentile_us(double fraction) const
+{
+    uint64_t rank = uint64_t(std::ceil(fraction * double(count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank && seen > 0) {
+            return double(std::min(uint64_t(2) << i, max_ns)) / 1000.0;
+        }
+    }
+    return 0.0;
+}
+
+#ifdef __linux__
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t read_size = 64 * 1024;
+
+class Unique_Fd {
+private:
+    int fd_;
+
+public:
+    explicit Unique_Fd(int fd = -1)
+        : fd_(fd)
+    {
+    }
+    ~Unique_Fd()
+    {
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+    Unique_Fd(Unique_Fd&& other) noexcept
+        : fd_(other.fd_)
+    {
+        other.fd_ = -1;
+    }
+    Unique_Fd& operator=(Unique_Fd&& other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+
+    int get() const { return fd_; }
+};
+
+struct Connection {
+    Unique_Fd fd;
+    std::string input; // a line that hasn't ended yet
+    std::string output; // replies the socket didn't take yet
+    bool sent_close = false; // gets its "end" once the report is complete
+};
+
+class Daemon {
+private:
+    Computer_Club club_;
+    Output_Sink& output_;
+    Latency_Stats latency_;
+    std::string socket_path_;
+    Unique_Fd epoll_fd_;
+    Unique_Fd listen_fd_;
+    Unique_Fd log_fd_;
+    Unique_Fd inotify_fd_;
+    Unique_Fd signal_fd_;
+    std::string log_input_; // a line of the log that hasn't ended yet
+    std::unordered_map<int, Connection> connections_;
+    bool closing_ = false;
+
+    void watch_(int fd, uint32_t events, int operation = EPOLL_CTL_ADD);
+    void handle_line_(std::string_view line, Clock::time_point arrival, Connection* connection);
+    void handle_command_(std::string_view command, Connection& connection);
+    void feed_(std::string& pending, std::string_view data, Clock::time_point arrival, Connection* connection);
+    void read_log_();
+    void accept_();
+    void read_connection_(Connection& connection);
+    void write_connection_(Connection& connection);
+    void close_connection_(int fd);
+
+public:
+    Daemon(const std::string& log_filename, const std::string& socket_path, Output_Sink& output);
+    ~Daemon();
+    void run();
+};
+
+[[noreturn]] void throw_system_error(const std::string& what)
+{
+    throw std::runtime_error("Error: " + what + ": " + std::strerror(errno));
+}
+
+// A socket left behind by a daemon that didn't shut down is removed, so bind
+// can take its path. Anything else at the path, a socket somebody still
+// listens on included, is left alone.
+void remove_stale_socket(const std::string& socket_path, const sockaddr_un& address)
+{
+    struct stat status;
+    if (lstat(socket_path.c_str(), &status) != 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw_system_error("cannot stat <" + socket_path + ">");
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        throw std::runtime_error("Error: <" + socket_path + "> exists and is not a socket");
+    }
+    Unique_Fd probe(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (probe.get() < 0) {
+        throw_system_error("socket");
+    }
+    if (connect(probe.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+        throw std::runtime_error("Error: another daemon is listening on <" + socket_path + ">");
+    }
+    unlink(socket_path.c_str());
+}
+
+Daemon::Daemon(const std::string& log_filename, const std::string& socket_path, Output_Sink& output)
+    : club_(log_filename, Input_Mode::Live, output)
+    , output_(output)
+    , socket_path_(socket_path)
+{
+    epoll_fd_ = Unique_Fd(epoll_create1(EPOLL_CLOEXEC));
+    if (epoll_fd_.get() < 0) {
+        throw_system_error("epoll_create1");
+    }
+
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Error: socket path <" + socket_path + "> is too long");
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    remove_stale_socket(socket_path, address);
+    listen_fd_ = Unique_Fd(socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (listen_fd_.get() < 0
+        || bind(listen_fd_.get(), reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listen_fd_.get(), SOMAXCONN) != 0) {
+        throw_system_error("cannot listen on <" + socket_path + ">");
+    }
+    watch_(listen_fd_.get(), EPOLLIN);
+
+    // regular files are always "ready" for epoll, so appends are noticed with inotify
+    log_fd_ = Unique_Fd(open(log_filename.c_str(), O_RDONLY | O_CLOEXEC));
+    inotify_fd_ = Unique_Fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC));
+    if (log_fd_.get() < 0 || inotify_fd_.get() < 0
+        || lseek(log_fd_.get(), off_t(club_.events_offset()), SEEK_SET) < 0
+        || inotify_add_watch(inotify_fd_.get(), log_filename.c_str(), IN_MODIFY) < 0) {
+        throw_system_error("cannot tail <" + log_filename + ">");
+    }
+    watch_(inotify_fd_.get(), EPOLLIN);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    signal_fd_ = Unique_Fd(signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC));
+    if (signal_fd_.get() < 0) {
+        throw_system_error("signalfd");
+    }
+    watch_(signal_fd_.get(), EPOLLIN);
+}
+Daemon::~Daemon()
+{
+    unlink(socket_path_.c_str());
+}
+void Daemon::watch_(int fd, uint32_t events, int operation)
+{
+    epoll_event event {};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_.get(), operation, fd, &event) != 0) {
+        throw_system_error("epoll_ctl");
+    }
+}
+void Daemon::handle_line_(std::string_view line, Clock::time_point arrival, Connection* connection)
+{
+    if (connection != nullptr && !line.empty() && line[0] >= 'A' && line[0] <= 'Z') {
+        handle_command_(line, *connection);
+        return;
+    }
+    try {
+        if (club_.ingest_line(line)) {
+            latency_.record(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - arrival).count()));
+        }
+    } catch (const std::exception& e) {
+        // a log file would end here; live, only this line is lost
+        output_.write_line(e.what());
+        if (connection != nullptr) {
+            connection->output.append(e.what()).push_back('\n');
+        }
+    }
+}
+void Daemon::handle_command_(std::string_view command, Connection& connection)
+{
+    std::string& reply = connection.output;
+    char buffer[max_table_size + 64];
+    if (command == "STATUS") {
+        Club_Status status = club_.status();
+        reply.append("time ").append(buffer, format_time(buffer, status.last_event_time)).push_back('\n');
+        reply.append("free ").append(buffer, format_int(buffer, status.free_tables)).push_back('\n');
+        reply.append("queue ").append(buffer, format_int(buffer, int(status.queue_length))).push_back('\n');
+        reply.append("clients ").append(buffer, format_int(buffer, status.clients_present)).push_back('\n');
+        for (size_t i = 0; i < status.tables.size(); ++i) {
+            reply.append("table ").append(buffer, format_table(buffer, status.tables[i]));
+            reply.append(status.occupied[i] ? " busy\n" : " free\n");
+        }
+    } else if (command == "STATS") {
+        int size = std::snprintf(buffer, sizeof(buffer), "events %llu\nlatency_avg_us %.2f\n",
+            static_cast<unsigned long long>(latency_.count), latency_.average_us());
+        reply.append(buffer, size_t(size));
+        size = std::snprintf(buffer, sizeof(buffer), "latency_p50_us %.2f\nlatency_p99_us %.2f\nlatency_max_us %.2f\n",
+            latency_.percentile_us(0.5), latency_.percentile_us(0.99), double(latency_.max_ns) / 1000.0);
+        reply.append(buffer, size_t(size));
+    } else if (command == "CLOSE") {
+        // its "end" is sent by run(), after the closing report
+        closing_ = true;
+        connection.sent_close = true;
+        return;
+    } else {
+        reply.append("Error: unknown command\n");
+        return;
+    }
+    reply.append("end\n");
+}
+void Daemon::feed_(std::string& pending, std::string_view data, Clock::time_point arrival, Connection* connection)
+{
+    pending.append(data);
+    std::string_view lines = pending;
+    size_t end;
+    while ((end = lines.find('\n')) != std::string_view::npos) {
+        handle_line_(lines.substr(0, end), arrival, connection);
+        lines.remove_prefix(end + 1);
+    }
+    pending.erase(0, pending.size() - lines.size());
+}
+void Daemon::read_log_()
+{
+    char buffer[read_size];
+    ssize_t result;
+    while ((result = read(log_fd_.get(), buffer, sizeof(buffer))) > 0) {
+        feed_(log_input_, std::string_view(buffer, size_t(result)), Clock::now(), nullptr);
+    }
+}
+void Daemon::accept_()
+{
+    int fd;
+    while ((fd = accept4(listen_fd_.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        watch_(fd, EPOLLIN | EPOLLRDHUP);
+        connections_.emplace(fd, Connection { Unique_Fd(fd), {}, {} });
+    }
+}
+void Daemon::read_connection_(Connection& connection)
+{
+    char buffer[read_size];
+    ssize_t result;
+    while ((result = read(connection.fd.get(), buffer, sizeof(buffer))) > 0) {
+        feed_(connection.input, std::string_view(buffer, size_t(result)), Clock::now(), &connection);
+    }
+    if (result == 0 || (errno != EAGAIN && errno != EINTR)) {
+        if (!connection.input.empty()) { // the last line may lack its '\n'
+            handle_line_(connection.input, Clock::now(), &connection);
+            connection.input.clear();
+        }
+        write_connection_(connection);
+        // a client that sent CLOSE and stopped writing still waits for its "end"
+        if (!connection.sent_close) {
+            close_connection_(connection.fd.get());
+        }
+        return;
+    }
+    write_connection_(connection);
+}
+void Daemon::write_connection_(Connection& connection)
+{
+    bool was_blocked = !connection.output.empty();
+    while (!connection.output.empty()) {
+        ssize_t result = send(connection.fd.get(), connection.output.data(), connection.output.size(), MSG_NOSIGNAL);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                connection.output.clear(); // the client is gone
+            }
+            break;
+        }
+        connection.output.erase(0, size_t(result));
+    }
+    // only ask for EPOLLOUT while replies are waiting
+    if (!connection.output.empty()) {
+        watch_(connection.fd.get(), EPOLLIN | EPOLLRDHUP | EPOLLOUT, EPOLL_CTL_MOD);
+    } else if (was_blocked) {
+        watch_(connection.fd.get(), EPOLLIN | EPOLLRDHUP, EPOLL_CTL_MOD);
+    }
+}
+void Daemon::close_connection_(int fd)
+{
+    epoll_ctl(epoll_fd_.get(), EPOLL_CTL_DEL, fd, nullptr);
+    connections_.erase(fd);
+}
+void Daemon::run()
+{
+    output_.write_time(club_.get_start_time());
+    read_log_(); // events already in the log
+    output_.flush();
+
+    std::array<epoll_event, 64> events;
+    while (!closing_) {
+        int ready = epoll_wait(epoll_fd_.get(), events.data(), int(events.size()), -1);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready < 0) {
+            throw_system_error("epoll_wait");
+        }
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_.get()) {
+                accept_();
+            } else if (fd == inotify_fd_.get()) {
+                char buffer[4096];
+                while (read(inotify_fd_.get(), buffer, sizeof(buffer)) > 0) {
+                }
+                read_log_();
+            } else if (fd == signal_fd_.get()) {
+                closing_ = true;
+            } else if (auto it = connections_.find(fd); it != connections_.end()) {
+                if (events[i].events & EPOLLOUT) {
+                    write_connection_(it->second);
+                }
+                if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    read_connection_(it->second);
+                }
+            }
+        }
+        output_.flush();
+    }
+
+    read_log_();
+    if (!log_input_.empty()) {
+        handle_line_(log_input_, Clock::now(), nullptr);
+    }
+    club_.close_day();
+    output_.write_time(club_.get_end_time());
+    club_.print_tables();
+    output_.flush();
+    report_metrics(club_.metrics());
+    // CLOSE gets its "end" once the report is complete
+    for (auto& [fd, connection] : connections_) {
+        if (connection.sent_close) {
+            connection.output.append("end\n");
+        }
+        write_connection_(connection);
+    }
+}
+}
+
+bool run_daemon(const std::string& log_filename, const std::string& socket_path, Output_Sink& output)
+{
+    try {
+        Daemon daemon(log_filename, socket_path, output);
+        daemon.run();
+    } catch (const std::exception& e) {
+        output.write_line(e.what());
+        return false;
+    }
+    return true;
+}
+#else
+bool run_daemon(const std::string&, const std::string&, Output_Sink& output)
+{
+    output.write_line("Error: daemon mode needs Linux (epoll, inotify)");
+    return false;
+}
+#endif
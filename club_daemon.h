@@ -0,0 +1,33 @@
+#ifndef RECRUITMENT_TEST_CLUB_DAEMON_H
+#define RECRUITMENT_TEST_CLUB_DAEMON_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "output_sink.h"
+
+// Arrival-to-handled latency of live events, in a log2 histogram of
+// nanoseconds, so percentiles come out without keeping every sample.
+struct Latency_Stats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    std::array<uint64_t, 64> buckets {}; // bucket i: [2^i, 2^(i+1)) ns
+
+    void record(uint64_t ns);
+    double average_us() const;
+    double percentile_us(double fraction) const; // upper bound of its bucket, at most max_ns
+};
+
+// Runs a club live: the header is read from log_filename, then events are
+// handled as they arrive, from lines appended to that file (it is tailed)
+// and from clients of a Unix domain socket at socket_path. The report goes to
+// output as it is produced. Socket clients may also send, one per line:
+//   STATUS  occupancy, queue and revenue so far
+//   STATS   events handled and their latency
+//   CLOSE   close the day: the report is finished and the daemon exits
+// SIGINT and SIGTERM close the day too. Returns false if the header or the
+// socket could not be set up (the error is written to output).
+bool run_daemon(const std::string& log_filename, const std::string& socket_path, Output_Sink& output);
+
+#endif // RECRUITMENT_TEST_CLUB_DAEMON_H
@@ -0,0 +1,187 @@
+#include "event_pipeline.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+Pipelined_Event_Source::Pipelined_Event_Source(const std::string& filename, uint64_t offset,
+    std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , filename_(filename)
+    , start_offset_(offset)
+    , position_(offset)
+    , stopping_(false)
+    , running_(false)
+    , current_(nullptr)
+    , next_event_(0)
+{
+    for (Chunk& chunk : chunks_) {
+        free_.push(&chunk);
+    }
+}
+Pipelined_Event_Source::~Pipelined_Event_Source()
+{
+    if (running_) {
+        stop_();
+    }
+}
+void Pipelined_Event_Source::start_()
+{
+    stopping_ = false;
+    reader_ = std::thread(&Pipelined_Event_Source::read_chunks_, this);
+    lexer_ = std::thread(&Pipelined_Event_Source::lex_chunks_, this);
+    running_ = true;
+}
+void Pipelined_Event_Source::stop_()
+{
+    // keep handing chunks back until the reader's last one has come round,
+    // so neither thread is left waiting for one
+    stopping_ = true;
+    while (current_ == nullptr || !current_->last) {
+        if (current_ != nullptr) {
+            free_.push(current_);
+        }
+        current_ = lexed_.pop();
+    }
+    reader_.join();
+    lexer_.join();
+    free_.push(current_);
+    current_ = nullptr;
+    next_event_ = 0;
+    running_ = false;
+}
+void Pipelined_Event_Source::read_chunks_()
+{
+    std::ifstream input_file(filename_, std::ios::binary);
+    input_file.seekg(std::streamoff(start_offset_));
+    std::string carry; // the start of a line the last chunk cut off
+    uint64_t offset = start_offset_;
+    while (true) {
+        Chunk* chunk = free_.pop();
+        chunk->events.clear();
+        chunk->error = nullptr;
+        chunk->offset = offset;
+        chunk->size = 0;
+        chunk->last = true;
+        if (stopping_) {
+            read_.push(chunk);
+            return;
+        }
+        try {
+            if (!input_file) {
+                throw std::runtime_error("Error: cannot open input file <" + filename_ + ">");
+            }
+            chunk->bytes.resize(std::max(chunk_size, 2 * carry.size()));
+            std::memcpy(chunk->bytes.data(), carry.data(), carry.size());
+            chunk->size = carry.size();
+            carry.clear();
+            // read until the chunk holds a line end, growing it for a line longer than a chunk
+            while (true) {
+                input_file.read(chunk->bytes.data() + chunk->size, std::streamsize(chunk->bytes.size() - chunk->size));
+                chunk->size += size_t(input_file.gcount());
+                if (!input_file) {
+                    if (input_file.bad()) {
+                        throw std::runtime_error("Error: cannot read input file <" + filename_ + ">");
+                    }
+                    break; // end of file, the last line may lack its '\n'
+                }
+                size_t line_end = std::string_view(chunk->bytes.data(), chunk->size).rfind('\n');
+                if (line_end != std::string_view::npos) {
+                    carry.assign(chunk->bytes.data() + line_end + 1, chunk->size - line_end - 1);
+                    chunk->size = line_end + 1;
+                    chunk->last = false;
+                    break;
+                }
+                chunk->bytes.resize(2 * chunk->bytes.size());
+            }
+        } catch (...) {
+            chunk->error = std::current_exception();
+            chunk->last = true;
+        }
+        offset += chunk->size;
+        bool last = chunk->last;
+        read_.push(chunk);
+        if (last) {
+            return;
+        }
+    }
+}
+void Pipelined_Event_Source::lex_chunks_()
+{
+    bool failed = false;
+    while (true) {
+        Chunk* chunk = read_.pop();
+        if (chunk->error != nullptr) {
+            failed = true;
+        }
+        if (!failed) {
+            try {
+                std::string_view buffer(chunk->bytes.data(), chunk->size);
+                std::string_view line;
+                Event_View event(Time(0, 0), 0, {});
+                while (next_line(buffer, line)) {
+                    if (lex_line_(line, event)) {
+                        std::string_view client_name = lex_client_name(event);
+                        uint64_t end = chunk->offset + uint64_t(buffer.data() - chunk->bytes.data());
+                        chunk->events.push_back({ event.time, event.ID, event.table, event.body, client_name, end });
+                    }
+                }
+            } catch (...) {
+                // the club gets the events before the bad line, then the error
+                chunk->error = std::current_exception();
+                failed = true;
+                stopping_ = true;
+            }
+        }
+        bool last = chunk->last;
+        lexed_.push(chunk);
+        if (last) {
+            return;
+        }
+    }
+}
+bool Pipelined_Event_Source::next(Event_View& event)
+{
+    if (!running_) {
+        start_();
+    }
+    while (current_ == nullptr || next_event_ == current_->events.size()) {
+        if (current_ != nullptr) {
+            if (current_->error != nullptr) {
+                std::rethrow_exception(std::exchange(current_->error, nullptr));
+            }
+            if (current_->last) {
+                return false;
+            }
+            free_.push(current_);
+        }
+        current_ = lexed_.pop();
+        next_event_ = 0;
+    }
+
+    const Lexed_Event& lexed = current_->events[next_event_++];
+    event.time = lexed.time;
+    event.ID = lexed.ID;
+    event.body = lexed.body;
+    event.table = lexed.table;
+    event.client = lexed.client_name.empty() ? no_client : names_.intern(lexed.client_name);
+    position_ = lexed.end;
+    return true;
+}
+uint64_t Pipelined_Event_Source::position()
+{
+    return position_;
+}
+void Pipelined_Event_Source::seek(uint64_t offset)
+{
+    if (offset > std::filesystem::file_size(filename_)) {
+        throw std::runtime_error("Error: position is past the end of input");
+    }
+    if (running_) {
+        stop_();
+    }
+    start_offset_ = offset;
+    position_ = offset;
+}
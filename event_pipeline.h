@@ -0,0 +1,76 @@
+#ifndef RECRUITMENT_TEST_EVENT_PIPELINE_H
+#define RECRUITMENT_TEST_EVENT_PIPELINE_H
+
+#include <array>
+#include <atomic>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "parsing_functions.h"
+#include "spsc_ring.h"
+
+// Reads and lexes a text log on two threads of its own while the club
+// simulates: a reader thread fills chunks with whole lines of the file, a
+// lexer thread splits them into events (time, ID, body, client name, table)
+// and next(), on the club's thread, only interns the names, so the
+// Name_Table is never shared. Chunks go round reader -> lexer -> club ->
+// reader on SPSC rings; there are num_of_chunks of them, which bounds how
+// far ahead of the club the other two threads can get.
+// The threads start on the first call to next(). Positions are byte offsets
+// into the file, as for Stream_Event_Source.
+class Pipelined_Event_Source : public Event_Source {
+private:
+    static constexpr size_t num_of_chunks = 8;
+    static constexpr size_t chunk_size = 256 * 1024;
+
+    struct Lexed_Event {
+        Time time;
+        int ID;
+        int table;
+        std::string_view body;
+        std::string_view client_name; // empty if the body names no client
+        uint64_t end; // offset just past the event's line
+    };
+    struct Chunk {
+        std::vector<char> bytes;
+        size_t size = 0;
+        uint64_t offset = 0; // of bytes[0] in the file
+        bool last = false; // the reader's last chunk, the file ended or it was stopped
+        std::vector<Lexed_Event> events;
+        std::exception_ptr error; // after events, nothing is lexed past it
+    };
+
+    std::string filename_;
+    uint64_t start_offset_; // where the reader starts
+    uint64_t position_;
+    std::array<Chunk, num_of_chunks> chunks_;
+    Spsc_Ring<Chunk*, num_of_chunks> free_; // club -> reader
+    Spsc_Ring<Chunk*, num_of_chunks> read_; // reader -> lexer
+    Spsc_Ring<Chunk*, num_of_chunks> lexed_; // lexer -> club
+    std::atomic<bool> stopping_;
+    std::thread reader_;
+    std::thread lexer_;
+    bool running_;
+    Chunk* current_; // the chunk next() takes events from
+    size_t next_event_;
+
+    void start_();
+    void stop_();
+    void read_chunks_();
+    void lex_chunks_();
+
+public:
+    Pipelined_Event_Source(const std::string& filename, uint64_t offset,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    ~Pipelined_Event_Source() override;
+
+    Pipelined_Event_Source(const Pipelined_Event_Source&) = delete;
+    Pipelined_Event_Source& operator=(const Pipelined_Event_Source&) = delete;
+
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+#endif // RECRUITMENT_TEST_EVENT_PIPELINE_H
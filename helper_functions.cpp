@@ -1,48 +1,195 @@
 #include "helper_functions.h"
+#include <array>
 
-bool is_valid_client_name(const std::string& client_name)
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CLOSEOUT_HAS_AVX2 1
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+// [a-z0-9_-], built at compile time so the name check is one load per char
+constexpr std::array<bool, 256> client_name_chars = [] {
+    std::array<bool, 256> chars {};
+    for (int c = 'a'; c <= 'z'; ++c) {
+        chars[c] = true;
+    }
+    for (int c = '0'; c <= '9'; ++c) {
+        chars[c] = true;
+    }
+    chars['_'] = true;
+    chars['-'] = true;
+    return chars;
+}();
+
+#if defined(__SSE2__)
+// true if all 16 bytes at data are in [a-z0-9_-]; bytes >= 0x80 compare as
+// negative and so fall outside both ranges
+bool is_client_name_block(const char* data)
 {
-    return std::regex_match(client_name, std::regex("^[a-z0-9_-]+$"));
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(block, _mm_set1_epi8('9' + 1)));
+    __m128i punct = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('_')), _mm_cmpeq_epi8(block, _mm_set1_epi8('-')));
+    __m128i valid = _mm_or_si128(_mm_or_si128(lower, digit), punct);
+    return _mm_movemask_epi8(valid) == 0xFFFF;
 }
-bool client_exists(const std::unordered_map<std::string, Client>& clients, const std::string& client_name)
+#endif
+
+// bills tables [first, last) whose bit is set in closing_word (bit 0 = table first)
+void close_tables_scalar(Table_Columns& tables, uint64_t closing_word, int first, int last, Minutes closing_time, int cost_per_hour)
 {
-    return clients.find(client_name) != clients.end();
+    for (int i = first; i < last; ++i) {
+        if ((closing_word >> (i - first)) & 1) {
+            Minutes occupied_for = std::max(closing_time - tables.start[i], Minutes(0));
+            tables.occupied_minutes[i] += occupied_for;
+            tables.revenue[i] += int((occupied_for + 59) / 60) * cost_per_hour;
+        }
+    }
 }
-bool is_valid_table_number(int table_number, const std::vector<Table>& tables)
+
+#ifdef CLOSEOUT_HAS_AVX2
+// end - start of 4 tables, at least 0
+__attribute__((target("avx2"))) __m256i occupied_for_4(const Minutes* start, __m256i end)
 {
-    return table_number >= 1 && table_number <= tables.size();
+    __m256i occupied_for = _mm256_sub_epi64(end, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(start)));
+    return _mm256_andnot_si256(_mm256_cmpgt_epi64(_mm256_setzero_si256(), occupied_for), occupied_for);
 }
-bool is_table_occupied(const std::vector<Table>& tables, int table_number)
+__attribute__((target("avx2"))) void add_4(Minutes* totals, __m256i mask, __m256i minutes)
 {
-    return tables[table_number - 1].occupied;
+    __m256i* total = reinterpret_cast<__m256i*>(totals);
+    _mm256_storeu_si256(total, _mm256_add_epi64(_mm256_loadu_si256(total), _mm256_and_si256(mask, minutes)));
 }
-bool is_table_available(const std::vector<Table>& tables)
+// Same as close_tables_scalar for a full word of 64 tables, 8 lanes at a time.
+// Minutes are 64-bit, but a stay never outlasts its shift, so the minutes of
+// a stay are narrowed to 32-bit lanes for the hours and the revenue. Rounded
+// hours are ceil(minutes / 60.0f), exact while a stay is shorter than 2^22
+// minutes (~8 years).
+__attribute__((target("avx2"))) void close_tables_avx2(Table_Columns& tables, uint64_t closing_word, int first, Minutes closing_time, int cost_per_hour)
 {
-    for (const auto& table : tables) {
-        if (!table.occupied) {
-            return true;
+    const __m256i lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i end = _mm256_set1_epi64x(closing_time);
+    const __m256i cost = _mm256_set1_epi32(cost_per_hour);
+    const __m256 minutes_per_hour = _mm256_set1_ps(60.0f);
+
+    for (int lane = 0; lane < 64; lane += 8) {
+        int lane_mask = int((closing_word >> lane) & 0xFF);
+        if (lane_mask == 0) {
+            continue;
         }
+        int i = first + lane;
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(lane_mask), lane_bits), lane_bits);
+
+        __m256i occupied_low = occupied_for_4(&tables.start[i], end);
+        __m256i occupied_high = occupied_for_4(&tables.start[i + 4], end);
+        add_4(&tables.occupied_minutes[i], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(mask)), occupied_low);
+        add_4(&tables.occupied_minutes[i + 4], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(mask, 1)), occupied_high);
+
+        __m256i occupied_for = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm256_castsi256_si128(_mm256_permutevar8x32_epi32(occupied_low, low_halves))),
+            _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(occupied_high, low_halves)), 1);
+        __m256 hours_ps = _mm256_ceil_ps(_mm256_div_ps(_mm256_cvtepi32_ps(occupied_for), minutes_per_hour));
+        __m256i revenue = _mm256_mullo_epi32(_mm256_cvtps_epi32(hours_ps), cost);
+
+        __m256i* revenue_total = reinterpret_cast<__m256i*>(&tables.revenue[i]);
+        _mm256_storeu_si256(revenue_total, _mm256_add_epi32(_mm256_loadu_si256(revenue_total), _mm256_and_si256(mask, revenue)));
     }
-    return false;
 }
-void free_table(Table& table, const Time& event_time, int cost_per_hour)
+
+bool cpu_has_avx2()
 {
-    table.occupied = false;
-    table.occupied_time_end = event_time;
-    Time client_occupied_for = table.occupied_time_end - table.occupied_time_start;
-    table.total_occupied_time += client_occupied_for;
-    int total_hours = client_occupied_for.hour + (client_occupied_for.minute > 0 ? 1 : 0);
-    table.revenue += total_hours * cost_per_hour;
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
 }
-std::queue<Client> remove_client_from_queue(std::queue<Client>& waiting_list,
-                                            const std::string& client_name)
+#endif
+}
+
+bool is_valid_client_name(std::string_view client_name)
 {
-    std::queue<Client> temp_queue;
+    // ^[a-z0-9_-]+$, checked by hand since every lexed event now goes through here
+    if (client_name.empty()) {
+        return false;
+    }
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= client_name.size(); i += 16) {
+        if (!is_client_name_block(client_name.data() + i)) {
+            return false;
+        }
+    }
+#endif
+    for (; i < client_name.size(); ++i) {
+        if (!client_name_chars[static_cast<unsigned char>(client_name[i])]) {
+            return false;
+        }
+    }
+    return true;
+}
+bool client_exists(std::span<const Client> clients, int client)
+{
+    return client != no_client && client < int(clients.size()) && clients[client].present;
+}
+bool is_valid_table_number(int table_number, const Table_Columns& tables)
+{
+    return table_number >= 1 && table_number <= tables.size();
+}
+bool is_table_occupied(const Table_Columns& tables, int table_number)
+{
+    return tables.occupied(table_number - 1);
+}
+bool is_table_available(const Free_Table_Set& free_tables)
+{
+    return free_tables.any();
+}
+void occupy_table(Table_Columns& tables, int table_index, const Time& event_time)
+{
+    tables.free.mark_occupied(table_index);
+    tables.start[table_index] = event_time.minutes;
+}
+void free_table(Table_Columns& tables, int table_index, const Time& event_time, int cost_per_hour)
+{
+    tables.free.mark_free(table_index);
+    Minutes client_occupied_for = std::max(event_time.minutes - tables.start[table_index], Minutes(0));
+    tables.occupied_minutes[table_index] += client_occupied_for;
+    int total_hours = int((client_occupied_for + 59) / 60); // every started hour is paid in full
+    tables.revenue[table_index] += total_hours * cost_per_hour;
+}
+std::queue<int> remove_client_from_queue(std::queue<int>& waiting_list, int client)
+{
+    std::queue<int> temp_queue;
     while (!waiting_list.empty()) {
-        if (waiting_list.front().name != client_name) {
+        if (waiting_list.front() != client) {
             temp_queue.push(waiting_list.front());
         }
         waiting_list.pop();
     }
     return temp_queue;
 }
+void free_tables_at_close(Table_Columns& tables, const std::vector<uint64_t>& closing, const Time& closing_time, int cost_per_hour)
+{
+    // bit i of closing = table index i is billed up to closing_time and freed
+    static_assert(sizeof(Minutes) == 8 && sizeof(int) == 4, "the AVX2 kernel works on 64-bit minutes and 32-bit revenue");
+    int num_of_tables = tables.size();
+    for (size_t word = 0; word < closing.size(); ++word) {
+        if (closing[word] == 0) {
+            continue;
+        }
+        int first = int(word * 64);
+        int last = std::min(first + 64, num_of_tables);
+#ifdef CLOSEOUT_HAS_AVX2
+        if (last - first == 64 && cpu_has_avx2()) {
+            close_tables_avx2(tables, closing[word], first, closing_time.minutes, cost_per_hour);
+        } else {
+            close_tables_scalar(tables, closing[word], first, last, closing_time.minutes, cost_per_hour);
+        }
+#else
+        close_tables_scalar(tables, closing[word], first, last, closing_time.minutes, cost_per_hour);
+#endif
+        tables.free.free_count += std::popcount(closing[word] & ~tables.free.words[word]);
+        tables.free.words[word] |= closing[word];
+        tables.free.first_word = std::min(tables.free.first_word, word);
+    }
+}
@@ -1,18 +1,22 @@
 #ifndef RECRUITMENT_TEST_HELPER_FUNCTIONS_H
 #define RECRUITMENT_TEST_HELPER_FUNCTIONS_H
 
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <queue>
 #include "Computer_Club_STRUCTS.h" // Time, Event, Client, Table
 
-bool is_valid_client_name(const std::string& client_name);
-bool client_exists(const std::unordered_map<std::string, Client>& clients, const std::string& client_name);
-bool is_valid_table_number(int table_number, const std::vector<Table>& tables);
-bool is_table_occupied(const std::vector<Table>& tables, int table_number);
-bool is_table_available(const std::vector<Table>& tables);
-void free_table(Table& table, const Time& event_time, int cost_per_hour);
-std::queue<Client> remove_client_from_queue(std::queue<Client>& waiting_list, const std::string& client_name);
+bool is_valid_client_name(std::string_view client_name);
+bool client_exists(std::span<const Client> clients, int client);
+bool is_valid_table_number(int table_number, const Table_Columns& tables);
+bool is_table_occupied(const Table_Columns& tables, int table_number);
+bool is_table_available(const Free_Table_Set& free_tables);
+void occupy_table(Table_Columns& tables, int table_index, const Time& event_time);
+void free_table(Table_Columns& tables, int table_index, const Time& event_time, int cost_per_hour);
+void free_tables_at_close(Table_Columns& tables, const std::vector<uint64_t>& closing, const Time& closing_time, int cost_per_hour);
+std::queue<int> remove_client_from_queue(std::queue<int>& waiting_list, int client);
 
 #endif // RECRUITMENT_TEST_HELPER_FUNCTIONS_H
@@ -0,0 +1,253 @@
+#include "instrumentation.h"
+
+#ifdef CLUB_INSTRUMENTATION
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define INSTRUMENTATION_HAS_TSC 1
+#include <x86intrin.h>
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr std::array<std::string_view, num_of_handlers> handler_names = {
+    "arrival", "sit", "start_waiting", "leave_table", "leave"
+};
+constexpr std::array<std::string_view, num_of_phases> phase_names = { "parse", "simulate", "output" };
+// indexed by Club_Error
+constexpr std::array<std::string_view, size_t(Club_Error::after_closing_time) + 1> error_names = {
+    "None", "InvalidClientName", "YouShallNotPass", "NotOpenYet", "InvalidSitBody", "TableOutOfRange",
+    "PlaceIsBusy", "ClientUnknown", "ICanWaitNoLonger!", "ClientSeated", "ClientNotSeated",
+    "UnknownEventID", "AfterClosingTime"
+};
+
+struct Registry {
+    std::mutex mutex;
+    Club_Metrics totals;
+    // start of the window that calibrates ticks against the steady clock
+    uint64_t start_ticks = Club_Metrics::now();
+    Clock::time_point start_time = Clock::now();
+};
+Registry registry;
+
+double nanoseconds_per_tick()
+{
+#ifdef INSTRUMENTATION_HAS_TSC
+    // a window of a few milliseconds is enough to get the TSC rate right
+    while (Clock::now() - registry.start_time < std::chrono::milliseconds(20)) {
+    }
+    double elapsed_ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - registry.start_time).count());
+    return elapsed_ns / double(Club_Metrics::now() - registry.start_ticks);
+#else
+    return 1.0;
+#endif
+}
+
+// what one now() adds to a lap: the least of many back to back reads
+uint64_t clock_read_ticks()
+{
+    static const uint64_t ticks = [] {
+        uint64_t least = UINT64_MAX;
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t before = Club_Metrics::now();
+            least = std::min(least, Club_Metrics::now() - before);
+        }
+        return least;
+    }();
+    return ticks;
+}
+double phase_ns(const Club_Metrics& metrics, size_t phase, double ns_per_tick)
+{
+    uint64_t overhead = metrics.phase_laps[phase] * clock_read_ticks();
+    return double(metrics.phase_ticks[phase] - std::min(metrics.phase_ticks[phase], overhead)) * ns_per_tick;
+}
+
+void append_format(std::string& out, const char* format, auto... values)
+{
+    char buffer[256];
+    int size = std::snprintf(buffer, sizeof(buffer), format, values...);
+    out.append(buffer, size_t(std::clamp(size, 0, int(sizeof(buffer)) - 1)));
+}
+unsigned long long as_ull(uint64_t value)
+{
+    return static_cast<unsigned long long>(value);
+}
+}
+
+uint64_t Club_Metrics::now()
+{
+#ifdef INSTRUMENTATION_HAS_TSC
+    return __rdtsc();
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+#endif
+}
+void Tick_Histogram::record(uint64_t ticks)
+{
+    ++count;
+    total += ticks;
+    ++buckets[std::bit_width(ticks | 1) - 1];
+}
+void Tick_Histogram::merge(const Tick_Histogram& other)
+{
+    count += other.count;
+    total += other.total;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+}
+void Club_Metrics::record_handler_(int ID, uint64_t ticks)
+{
+    ticks -= std::min(ticks, clock_read_ticks());
+    switch (ID) {
+    case 1:
+        handlers[size_t(Handler::arrival)].record(ticks);
+        break;
+    case 2:
+    case 12:
+        handlers[size_t(Handler::sit)].record(ticks);
+        break;
+    case 3:
+        handlers[size_t(Handler::start_waiting)].record(ticks);
+        break;
+    case 4:
+        handlers[size_t(Handler::leave_table)].record(ticks);
+        break;
+    case 11:
+        handlers[size_t(Handler::leave)].record(ticks);
+        break;
+    default:
+        break;
+    }
+}
+void Club_Metrics::merge(const Club_Metrics& other)
+{
+    for (size_t i = 0; i < event_counts.size(); ++i) {
+        event_counts[i] += other.event_counts[i];
+    }
+    for (size_t i = 0; i < error_counts.size(); ++i) {
+        error_counts[i] += other.error_counts[i];
+    }
+    for (size_t i = 0; i < handlers.size(); ++i) {
+        handlers[i].merge(other.handlers[i]);
+    }
+    for (size_t i = 0; i < phase_ticks.size(); ++i) {
+        phase_ticks[i] += other.phase_ticks[i];
+        phase_laps[i] += other.phase_laps[i];
+    }
+    peak_queue_depth = std::max(peak_queue_depth, other.peak_queue_depth);
+}
+
+void report_metrics(const Club_Metrics& metrics)
+{
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.totals.merge(metrics);
+}
+std::string metrics_json()
+{
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const Club_Metrics& totals = registry.totals;
+    double ns_per_tick = nanoseconds_per_tick();
+    std::string out = "{\n  \"events\": {";
+    const char* separator = "";
+    for (size_t ID = 0; ID < totals.event_counts.size(); ++ID) {
+        if (totals.event_counts[ID] > 0) {
+            if (ID == 15) {
+                append_format(out, "%s\"other\": %llu", separator, as_ull(totals.event_counts[ID]));
+            } else {
+                append_format(out, "%s\"%zu\": %llu", separator, ID, as_ull(totals.event_counts[ID]));
+            }
+            separator = ", ";
+        }
+    }
+    out += "},\n  \"errors\": {";
+    for (size_t i = 1; i < totals.error_counts.size(); ++i) {
+        append_format(out, "%s\"%s\": %llu", i == 1 ? "" : ", ", error_names[i].data(), as_ull(totals.error_counts[i]));
+    }
+    out += "},\n  \"handlers\": {";
+    for (size_t i = 0; i < totals.handlers.size(); ++i) {
+        const Tick_Histogram& histogram = totals.handlers[i];
+        append_format(out, "%s\n    \"%s\": {\"count\": %llu, \"total_ns\": %.0f, \"buckets\": [",
+            i == 0 ? "" : ",", handler_names[i].data(), as_ull(histogram.count), double(histogram.total) * ns_per_tick);
+        separator = "";
+        for (size_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+            if (histogram.buckets[bucket] > 0) {
+                append_format(out, "%s{\"le_ns\": %.1f, \"count\": %llu}", separator,
+                    double(uint64_t(2) << bucket) * ns_per_tick, as_ull(histogram.buckets[bucket]));
+                separator = ", ";
+            }
+        }
+        out += "]}";
+    }
+    append_format(out, "\n  },\n  \"sample_every\": %llu,\n  \"peak_queue_depth\": %zu,\n  \"phases_ns\": {", as_ull(sample_every), totals.peak_queue_depth);
+    for (size_t i = 0; i < totals.phase_ticks.size(); ++i) {
+        append_format(out, "%s\"%s\": %.0f", i == 0 ? "" : ", ", phase_names[i].data(), phase_ns(totals, i, ns_per_tick));
+    }
+    out += "}\n}\n";
+    return out;
+}
+std::string metrics_prometheus()
+{
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    const Club_Metrics& totals = registry.totals;
+    double ns_per_tick = nanoseconds_per_tick();
+    double seconds_per_tick = ns_per_tick / 1e9;
+    std::string out = "# TYPE club_events_total counter\n";
+    for (size_t ID = 0; ID < totals.event_counts.size(); ++ID) {
+        if (totals.event_counts[ID] > 0) {
+            if (ID == 15) {
+                append_format(out, "club_events_total{id=\"other\"} %llu\n", as_ull(totals.event_counts[ID]));
+            } else {
+                append_format(out, "club_events_total{id=\"%zu\"} %llu\n", ID, as_ull(totals.event_counts[ID]));
+            }
+        }
+    }
+    out += "# TYPE club_errors_total counter\n";
+    for (size_t i = 1; i < totals.error_counts.size(); ++i) {
+        append_format(out, "club_errors_total{reason=\"%s\"} %llu\n", error_names[i].data(), as_ull(totals.error_counts[i]));
+    }
+    out += "# TYPE club_handler_seconds histogram\n";
+    for (size_t i = 0; i < totals.handlers.size(); ++i) {
+        const Tick_Histogram& histogram = totals.handlers[i];
+        const char* name = handler_names[i].data();
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < histogram.buckets.size(); ++bucket) {
+            cumulative += histogram.buckets[bucket];
+            if (histogram.buckets[bucket] > 0) {
+                append_format(out, "club_handler_seconds_bucket{handler=\"%s\",le=\"%.3g\"} %llu\n",
+                    name, double(uint64_t(2) << bucket) * seconds_per_tick, as_ull(cumulative));
+            }
+        }
+        append_format(out, "club_handler_seconds_bucket{handler=\"%s\",le=\"+Inf\"} %llu\n", name, as_ull(histogram.count));
+        append_format(out, "club_handler_seconds_sum{handler=\"%s\"} %.9f\n", name, double(histogram.total) * seconds_per_tick);
+        append_format(out, "club_handler_seconds_count{handler=\"%s\"} %llu\n", name, as_ull(histogram.count));
+    }
+    out += "# TYPE club_handler_sample_every gauge\n";
+    append_format(out, "club_handler_sample_every %llu\n", as_ull(sample_every));
+    out += "# TYPE club_peak_queue_depth gauge\n";
+    append_format(out, "club_peak_queue_depth %zu\n", totals.peak_queue_depth);
+    out += "# TYPE club_phase_seconds_total counter\n";
+    for (size_t i = 0; i < totals.phase_ticks.size(); ++i) {
+        append_format(out, "club_phase_seconds_total{phase=\"%s\"} %.6f\n", phase_names[i].data(), phase_ns(totals, i, ns_per_tick) / 1e9);
+    }
+    return out;
+}
+#else
+void report_metrics(const Club_Metrics&)
+{
+}
+std::string metrics_json()
+{
+    return "{}\n";
+}
+std::string metrics_prometheus()
+{
+    return "";
+}
+#endif
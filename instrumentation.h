@@ -0,0 +1,139 @@
+#ifndef RECRUITMENT_TEST_INSTRUMENTATION_H
+#define RECRUITMENT_TEST_INSTRUMENTATION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Computer_Club_STRUCTS.h" // Club_Error
+
+// Hot-path counters of a club, compiled in only with -DCLUB_INSTRUMENTATION
+// (the CMake option of the same name). Without it Club_Metrics is an empty
+// class whose calls are inline no-ops, so the club pays nothing for them.
+//
+// Time is read from the TSC where there is one (a steady_clock otherwise) and
+// is split into phases by laps: every lap charges the time since the previous
+// one to a phase, so one clock read per step covers parse, simulate and output.
+// A clock read costs about as much as handling an event, so counters are
+// exact but only one event in sample_every is timed: handler histograms hold
+// those samples and phase times are scaled up from them.
+
+enum class Phase : uint8_t {
+    parse, // lexing and decoding events (Event_Source::next)
+    simulate, // handlers and closing time
+    output, // formatting and writing the report
+};
+constexpr size_t num_of_phases = 3;
+
+enum class Handler : uint8_t {
+    arrival, // 1
+    sit, // 2, 12
+    start_waiting, // 3
+    leave_table, // 4
+    leave, // 11
+};
+constexpr size_t num_of_handlers = 5;
+constexpr uint64_t sample_every = 16;
+
+#ifdef CLUB_INSTRUMENTATION
+constexpr bool instrumentation_enabled = true;
+
+// log2 histogram of ticks, bucket i: [2^i, 2^(i+1))
+struct Tick_Histogram {
+    uint64_t count = 0;
+    uint64_t total = 0;
+    std::array<uint64_t, 64> buckets {};
+
+    void record(uint64_t ticks);
+    void merge(const Tick_Histogram& other);
+};
+
+class Club_Metrics {
+private:
+    uint64_t last_lap_ = 0;
+    uint64_t weight_ = 0; // what a lap's ticks count for, 0 while not timing
+    uint64_t events_since_sample_ = 0;
+
+    void record_handler_(int ID, uint64_t ticks);
+
+public:
+    std::array<uint64_t, 16> event_counts {}; // by event ID, IDs past 14 go to 15
+    std::array<uint64_t, size_t(Club_Error::after_closing_time) + 1> error_counts {};
+    std::array<Tick_Histogram, num_of_handlers> handlers; // sampled
+    std::array<uint64_t, num_of_phases> phase_ticks {}; // estimated from the samples
+    std::array<uint64_t, num_of_phases> phase_laps {}; // to take the clock reads back out
+    size_t peak_queue_depth = 0;
+
+    static uint64_t now();
+
+    // times everything up to the next end_event()
+    void start_lap()
+    {
+        weight_ = 1;
+        last_lap_ = now();
+    }
+    // times the next event if it is due for a sample
+    void end_event()
+    {
+        if (++events_since_sample_ < sample_every) {
+            weight_ = 0;
+            return;
+        }
+        events_since_sample_ = 0;
+        weight_ = sample_every;
+        last_lap_ = now();
+    }
+    // charges the time since the last lap to phase, returns it (with the clock
+    // read, which the report takes back out)
+    uint64_t lap(Phase phase)
+    {
+        if (weight_ == 0) {
+            return 0;
+        }
+        uint64_t ticks = now();
+        uint64_t elapsed = ticks - last_lap_;
+        last_lap_ = ticks;
+        phase_ticks[size_t(phase)] += elapsed * weight_;
+        phase_laps[size_t(phase)] += weight_;
+        return elapsed;
+    }
+    void count_event(const Event_View& event)
+    {
+        ++event_counts[std::min<unsigned>(unsigned(event.ID), 15)];
+        if (event.generated && event.ID == 13) {
+            ++error_counts[size_t(event.error)];
+        }
+    }
+    void record_handler(int ID, uint64_t ticks)
+    {
+        if (weight_ != 0) {
+            record_handler_(ID, ticks);
+        }
+    }
+    void observe_queue(size_t depth) { peak_queue_depth = std::max(peak_queue_depth, depth); }
+
+    void merge(const Club_Metrics& other);
+};
+#else
+constexpr bool instrumentation_enabled = false;
+
+class Club_Metrics {
+public:
+    static constexpr uint64_t now() { return 0; }
+    void start_lap() { }
+    void end_event() { }
+    constexpr uint64_t lap(Phase) { return 0; }
+    void count_event(const Event_View&) { }
+    void record_handler(int, uint64_t) { }
+    void observe_queue(size_t) { }
+    void merge(const Club_Metrics&) { }
+};
+#endif
+
+// Process-wide totals: every finished club adds its metrics here (from any
+// thread), and they are written out once at exit.
+void report_metrics(const Club_Metrics& metrics);
+std::string metrics_json();
+std::string metrics_prometheus();
+
+#endif // RECRUITMENT_TEST_INSTRUMENTATION_H
@@ -0,0 +1,74 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+Mapped_File::Mapped_File(const std::string& filename)
+    : data_(nullptr)
+    , size_(0)
+{
+    // no mmap here, fall back to a single read of the whole file
+    std::ifstream input_file(filename, std::ios::binary);
+    if (!input_file.is_open()) {
+        throw std::runtime_error("Error: cannot open input file <" + filename + ">");
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(input_file), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+void Mapped_File::release_()
+{
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+}
+#else
+Mapped_File::Mapped_File(const std::string& filename)
+    : data_(nullptr)
+    , size_(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Error: cannot open input file <" + filename + ">");
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        throw std::runtime_error("Error: cannot stat input file <" + filename + ">");
+    }
+
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ > 0) { // mmap refuses zero-length mappings
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Error: cannot map input file <" + filename + ">");
+        }
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapping);
+    }
+    close(fd); // the mapping keeps its own reference to the file
+}
+void Mapped_File::release_()
+{
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
+Mapped_File::~Mapped_File()
+{
+    release_();
+}
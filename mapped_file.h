@@ -0,0 +1,32 @@
+#ifndef RECRUITMENT_TEST_MAPPED_FILE_H
+#define RECRUITMENT_TEST_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. On POSIX systems the file is mmap'ed, so
+// string_views into data() stay valid for the lifetime of the object without
+// copying anything onto the heap.
+class Mapped_File {
+private:
+    const char* data_;
+    size_t size_;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+
+    void release_();
+
+public:
+    explicit Mapped_File(const std::string& filename);
+    ~Mapped_File();
+
+    Mapped_File(const Mapped_File&) = delete;
+    Mapped_File& operator=(const Mapped_File&) = delete;
+
+    std::string_view data() const { return { data_, size_ }; }
+    size_t size() const { return size_; }
+};
+
+#endif // RECRUITMENT_TEST_MAPPED_FILE_H
@@ -0,0 +1,170 @@
+#include "multi_room.h"
+#include "Computer_Club.h"
+#include "arena.h"
+#include "mapped_file.h"
+#include "parallel_parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+namespace {
+// A room's report, with where the lines of each of its input events start,
+// so they can be put back among the other rooms' lines.
+class Room_Sink : public Output_Sink {
+public:
+    Memory_Sink text;
+    std::vector<size_t> event_starts; // then where the last event's lines end
+
+    void write_time(const Time& time) override { text.write_time(time); }
+    void write_event(const Event_View& event, const Name_Table& names) override
+    {
+        if (!event.generated) {
+            event_starts.push_back(text.str().size());
+        }
+        text.write_event(event, names);
+    }
+    void write_table(const Table& table) override { text.write_table(table); }
+    void write_line(std::string_view line) override { text.write_line(line); }
+    void write(std::string_view text_to_write) override { text.write(text_to_write); }
+
+    void end_events() { event_starts.push_back(text.str().size()); }
+    size_t events_written() const { return event_starts.size() - 1; }
+    std::string_view event_lines(size_t event) const
+    {
+        return std::string_view(text.str()).substr(event_starts[event], event_starts[event + 1] - event_starts[event]);
+    }
+    std::string_view tables() const { return std::string_view(text.str()).substr(event_starts.back()); }
+};
+
+struct Room_Run {
+    std::vector<size_t> events; // indexes into the log's events
+    Room_Sink report;
+    std::string error; // empty if the room ran to the end
+};
+}
+
+bool is_multi_room_log_file(const std::string& filename)
+{
+    std::ifstream input_file(filename, std::ios::binary);
+    char start[6] = {};
+    input_file.read(start, sizeof(start));
+    return input_file && is_multi_room_log(std::string_view(start, sizeof(start)));
+}
+std::vector<int> route_events(const Parsed_Log& log, const std::vector<Room>& rooms)
+{
+    // the room with table_number, -1 if none has it
+    auto room_of_table = [&rooms](int table_number) {
+        auto after = std::upper_bound(rooms.begin(), rooms.end(), table_number,
+            [](int number, const Room& room) { return number < room.first_table; });
+        if (after == rooms.begin()) {
+            return -1;
+        }
+        const Room& room = *std::prev(after);
+        return table_number < room.first_table + room.num_of_tables ? int(std::prev(after) - rooms.begin()) : -1;
+    };
+
+    std::vector<int> client_rooms(log.names.size(), -1);
+    for (const Event& event : log.events) {
+        if (event.client != no_client && event.table > 0 && client_rooms[event.client] == -1) {
+            client_rooms[event.client] = room_of_table(event.table);
+        }
+    }
+
+    std::vector<int> routes;
+    routes.reserve(log.events.size());
+    for (const Event& event : log.events) {
+        int room = event.table > 0 ? room_of_table(event.table) : -1;
+        if (room == -1 && event.client != no_client) {
+            room = client_rooms[event.client];
+        }
+        routes.push_back(std::max(room, 0));
+    }
+    return routes;
+}
+bool run_rooms(const std::string& filename, Output_Sink& output)
+{
+    Parsed_Log log;
+    std::vector<Room> rooms;
+    std::string parse_error; // of a bad line, after the events before it
+    try {
+        Mapped_File input(filename);
+        std::string_view buffer = input.data();
+        parse_rooms_header(buffer, log.start_time, log.end_time, rooms);
+        if (log.start_time.dated()) {
+            throw std::runtime_error("Error: a multi-room log can't be dated");
+        }
+        try {
+            Parallel_Event_Source events(input.data(), buffer.data() - input.data().data());
+            read_events(events, log);
+        } catch (const std::exception& e) {
+            parse_error = e.what();
+        }
+    } catch (const std::exception& e) {
+        output.write_line(e.what());
+        return false;
+    }
+
+    std::vector<int> routes = route_events(log, rooms);
+    std::vector<Room_Run> runs(rooms.size());
+    for (size_t i = 0; i < routes.size(); ++i) {
+        runs[routes[i]].events.push_back(i);
+    }
+
+    // the rooms share nothing but the log, which is only read from here on
+    size_t num_of_threads = std::min<size_t>(rooms.size(), std::max(std::thread::hardware_concurrency(), 1u));
+    Thread_Pool pool(num_of_threads);
+    for (size_t i = 0; i < rooms.size(); ++i) {
+        pool.submit([&log, &room = rooms[i], &run = runs[i]] {
+            thread_local Arena arena;
+            Club_Overrides overrides { .num_of_tables = room.num_of_tables,
+                .cost_per_hour = room.cost_per_hour,
+                .queue_capacity = room.queue_capacity,
+                .first_table = room.first_table,
+                .events = &run.events };
+            try {
+                Computer_Club club(log, overrides, run.report, &arena);
+                club.simulate();
+                run.report.end_events();
+                club.print_tables();
+                report_metrics(club.metrics());
+            } catch (const std::exception& e) {
+                run.report.end_events();
+                run.error = e.what();
+            }
+            arena.reset();
+        });
+    }
+    pool.wait();
+
+    // A failed room wrote its lines up to the event it failed on. The earliest
+    // failure in the log wins, a room's over a bad line after its event.
+    size_t end = log.events.size();
+    std::string error = parse_error;
+    for (const Room_Run& run : runs) {
+        if (!run.error.empty()) {
+            size_t written = run.report.events_written();
+            size_t failed_at = written == 0 ? 0 : run.events[written - 1] + 1;
+            if (failed_at <= end) {
+                end = failed_at;
+                error = run.error;
+            }
+        }
+    }
+
+    output.write_time(log.start_time);
+    std::vector<size_t> next_event(rooms.size(), 0);
+    for (size_t i = 0; i < end; ++i) {
+        output.write(runs[routes[i]].report.event_lines(next_event[routes[i]]++));
+    }
+    if (!error.empty()) {
+        output.write_line(error);
+        return false;
+    }
+    output.write_time(log.end_time);
+    for (const Room_Run& run : runs) {
+        output.write(run.report.tables());
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef RECRUITMENT_TEST_MULTI_ROOM_H
+#define RECRUITMENT_TEST_MULTI_ROOM_H
+
+#include <string>
+#include <vector>
+#include "output_sink.h"
+#include "parsing_functions.h" // Parsed_Log, Room
+
+// true if filename holds a multi-room log (see parse_rooms_header)
+bool is_multi_room_log_file(const std::string& filename);
+
+// The room each event of log goes to, by index into rooms. An event naming a
+// table of a room (a sit) goes to that room. Any other event goes to its
+// client's room: the room of the first table the client asks for anywhere in
+// the log, or the first room for a client who never asks for one (and for
+// events that name no client). A client sits down only in their own room;
+// asking for a table in another one is a ClientUnknown there.
+std::vector<int> route_events(const Parsed_Log& log, const std::vector<Room>& rooms);
+
+// Simulates a multi-room log: the log is parsed once (on every core), its
+// events are routed to the rooms, and every room is a club of its own that
+// replays its events on a thread of its own, with its own tables, price,
+// queue and Arena. Nothing is shared while they run; the rooms' lines are put
+// back in the order of the log afterwards, followed by one end-of-day report
+// with every room's tables. Errors are reported as for a single club, after
+// the lines of the events before the earliest failing one. Dated logs are not
+// supported. Returns false on an error.
+bool run_rooms(const std::string& filename, Output_Sink& output);
+
+#endif // RECRUITMENT_TEST_MULTI_ROOM_H
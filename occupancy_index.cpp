@@ -0,0 +1,351 @@
+#include "occupancy_index.h"
+#include "checkpoint.h"
+#include "parsing_functions.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+constexpr char index_magic[8] = { 'C', 'L', 'U', 'B', 'I', 'D', 'X', '\0' };
+constexpr uint32_t index_version = 1;
+constexpr uint32_t byte_order_mark = 0x01020304;
+constexpr size_t header_size = 48;
+// two int64 arrays of (tables + 1) * (buckets + 1) are plenty at 2^27 cells each
+constexpr uint64_t max_cells = uint64_t(1) << 27;
+
+Minutes floor_div(Minutes a, Minutes b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// adds the minutes of [start, end) to the buckets they fall in, row[b + 1]
+// being bucket b
+void add_minutes(int64_t* row, Minutes origin, Minutes bucket_minutes, size_t num_of_buckets, Minutes start, Minutes end)
+{
+    Minutes last = origin + Minutes(num_of_buckets) * bucket_minutes;
+    start = std::max(start, origin);
+    end = std::min(end, last);
+    while (start < end) {
+        Minutes bucket = (start - origin) / bucket_minutes;
+        Minutes bucket_end = std::min(origin + (bucket + 1) * bucket_minutes, end);
+        row[bucket + 1] += bucket_end - start;
+        start = bucket_end;
+    }
+}
+
+void check_bucket_boundary(const Time& time, Minutes bucket_minutes)
+{
+    if (time.minutes % bucket_minutes != 0) {
+        char text[max_time_size];
+        std::string time_text(text, format_time(text, time));
+        throw std::runtime_error("Error: <" + time_text + "> is not on a " + std::to_string(bucket_minutes)
+            + "-minute bucket boundary");
+    }
+}
+
+template <typename T>
+void put(std::string& bytes, T value)
+{
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+template <typename T>
+T get(const char* data, size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+std::string format_range(const Time& from, const Time& to)
+{
+    char buffer[2 * max_time_size + 3];
+    char* out = format_time(buffer, from);
+    *out++ = ' ';
+    *out++ = '-';
+    *out++ = ' ';
+    out = format_time(out, to);
+    return std::string(buffer, out);
+}
+// hours of the day, up to 24:00
+std::string format_hours(int from, int to)
+{
+    char buffer[2 * max_duration_size + 3];
+    char* out = format_duration(buffer, Time(from, 0));
+    *out++ = ' ';
+    *out++ = '-';
+    *out++ = ' ';
+    out = format_duration(out, Time(to, 0));
+    return std::string(buffer, out);
+}
+
+// "HH:MM" is a time of day, "YYYY-MM-DD HH:MM" a point on the timeline
+Time parse_query_time(const std::string& text, bool& dated)
+{
+    size_t space = text.find(' ');
+    dated = space != std::string::npos;
+    if (!dated) {
+        return parse_time(text);
+    }
+    int64_t day = parse_date(std::string_view(text).substr(0, space));
+    return Time::from_minutes(day * minutes_per_day) + parse_time(std::string_view(text).substr(space + 1));
+}
+
+// table numbers -> runs of consecutive ones, first and last
+std::vector<std::pair<int, int>> table_runs(std::vector<int> tables, int num_of_tables)
+{
+    if (tables.empty()) {
+        return { { 1, num_of_tables } };
+    }
+    std::sort(tables.begin(), tables.end());
+    tables.erase(std::unique(tables.begin(), tables.end()), tables.end());
+    std::vector<std::pair<int, int>> runs;
+    for (int table_number : tables) {
+        if (table_number < 1 || table_number > num_of_tables) {
+            throw std::runtime_error("Error: table number <" + std::to_string(table_number) + "> is out of range");
+        }
+        if (!runs.empty() && runs.back().second == table_number - 1) {
+            runs.back().second = table_number;
+        } else {
+            runs.emplace_back(table_number, table_number);
+        }
+    }
+    return runs;
+}
+
+Occupancy_Totals& operator+=(Occupancy_Totals& totals, const Occupancy_Totals& other)
+{
+    totals.occupied_minutes += other.occupied_minutes;
+    totals.revenue += other.revenue;
+    totals.open_minutes += other.open_minutes;
+    return totals;
+}
+
+std::string format_row(const std::string& range, const Occupancy_Totals& totals)
+{
+    char occupied[max_duration_size + 1];
+    *format_duration(occupied, Time::from_minutes(totals.occupied_minutes)) = '\0';
+    double utilization = totals.open_minutes > 0 ? 100.0 * double(totals.occupied_minutes) / double(totals.open_minutes) : 0.0;
+
+    char row[128];
+    int size = std::snprintf(row, sizeof(row), "%-35s %10s %12lld %11.1f%%", range.c_str(), occupied,
+        static_cast<long long>(totals.revenue), utilization);
+    return std::string(row, size_t(size));
+}
+}
+
+bool is_valid_bucket_length(Minutes bucket_minutes)
+{
+    return bucket_minutes > 0 && 60 % bucket_minutes == 0;
+}
+
+Occupancy_Index::Occupancy_Index(const Occupancy_Record& record, int num_of_tables, Minutes bucket_minutes)
+    : origin_(0)
+    , bucket_minutes_(bucket_minutes)
+    , num_of_tables_(num_of_tables)
+    , num_of_buckets_(0)
+{
+    if (!is_valid_bucket_length(bucket_minutes)) {
+        throw std::runtime_error("Error: index buckets have to split an hour evenly");
+    }
+    if (!record.shifts.empty()) {
+        Minutes first = record.shifts.front().first.minutes;
+        Minutes last = first;
+        for (const auto& [start, end] : record.shifts) {
+            first = std::min(first, start.minutes);
+            last = std::max({ last, start.minutes, end.minutes });
+        }
+        origin_ = floor_div(first, bucket_minutes) * bucket_minutes;
+        num_of_buckets_ = size_t((last - origin_ + bucket_minutes - 1) / bucket_minutes);
+    }
+    uint64_t row_size = num_of_buckets_ + 1;
+    if (row_size * (uint64_t(num_of_tables) + 1) > max_cells) {
+        throw std::runtime_error("Error: occupancy index would have too many buckets, make them longer");
+    }
+
+    size_t cells = (size_t(num_of_tables) + 1) * row_size;
+    storage_.assign(row_size + 2 * cells, 0);
+    int64_t* open = storage_.data();
+    int64_t* occupied = open + row_size;
+    int64_t* revenue = occupied + cells;
+
+    // each bucket's own value first (table t in row t + 1), then the sums
+    for (const auto& [start, end] : record.shifts) {
+        add_minutes(open, origin_, bucket_minutes, num_of_buckets_, start.minutes, end.minutes);
+    }
+    for (const Occupancy_Interval& interval : record.intervals) {
+        int64_t* row = occupied + (size_t(interval.table_index) + 1) * row_size;
+        add_minutes(row, origin_, bucket_minutes, num_of_buckets_, interval.start, interval.end);
+        if (num_of_buckets_ > 0) {
+            Minutes paid_at = std::max(interval.end - 1, interval.start); // the bucket the last minute is in
+            Minutes bucket = std::clamp(floor_div(paid_at - origin_, bucket_minutes), Minutes(0), Minutes(num_of_buckets_ - 1));
+            revenue[(size_t(interval.table_index) + 1) * row_size + size_t(bucket) + 1] += interval.revenue;
+        }
+    }
+    for (size_t b = 1; b < row_size; ++b) {
+        open[b] += open[b - 1];
+    }
+    for (int64_t* prefix : { occupied, revenue }) {
+        for (size_t t = 1; t <= size_t(num_of_tables); ++t) {
+            int64_t* row = prefix + t * row_size;
+            const int64_t* above = row - row_size;
+            for (size_t b = 1; b < row_size; ++b) {
+                row[b] += row[b - 1] + above[b] - above[b - 1];
+            }
+        }
+    }
+
+    open_ = open;
+    occupied_ = occupied;
+    revenue_ = revenue;
+}
+Occupancy_Index::Occupancy_Index(const std::string& path)
+    : file_(std::make_unique<Mapped_File>(path))
+{
+    std::string_view bytes = file_->data();
+    if (bytes.size() < header_size || std::memcmp(bytes.data(), index_magic, sizeof(index_magic)) != 0
+        || get<uint32_t>(bytes.data(), 8) != index_version || get<uint32_t>(bytes.data(), 12) != byte_order_mark) {
+        throw std::runtime_error("Error: <" + path + "> is not an occupancy index written on this machine");
+    }
+    origin_ = get<int64_t>(bytes.data(), 16);
+    bucket_minutes_ = get<int64_t>(bytes.data(), 24);
+    num_of_tables_ = get<int32_t>(bytes.data(), 32);
+    uint64_t num_of_buckets = get<uint64_t>(bytes.data(), 40);
+
+    uint64_t row_size = num_of_buckets + 1;
+    bool valid = is_valid_bucket_length(bucket_minutes_) && num_of_tables_ >= 0 && num_of_buckets < max_cells
+        && row_size * (uint64_t(num_of_tables_) + 1) <= max_cells
+        && bytes.size() == header_size + sizeof(int64_t) * (row_size + 2 * row_size * (uint64_t(num_of_tables_) + 1));
+    if (!valid) {
+        throw std::runtime_error("Error: occupancy index <" + path + "> is damaged");
+    }
+    num_of_buckets_ = size_t(num_of_buckets);
+
+    // the mapping is page aligned and the header a multiple of 8 bytes long
+    open_ = reinterpret_cast<const int64_t*>(bytes.data() + header_size);
+    occupied_ = open_ + row_size;
+    revenue_ = occupied_ + row_size * (size_t(num_of_tables_) + 1);
+}
+void Occupancy_Index::save(const std::string& path) const
+{
+    size_t row_size = num_of_buckets_ + 1;
+    size_t cells = (size_t(num_of_tables_) + 1) * row_size;
+    std::string bytes;
+    bytes.reserve(header_size + sizeof(int64_t) * (row_size + 2 * cells));
+    bytes.append(index_magic, sizeof(index_magic));
+    put(bytes, index_version);
+    put(bytes, byte_order_mark);
+    put(bytes, int64_t(origin_));
+    put(bytes, int64_t(bucket_minutes_));
+    put(bytes, int32_t(num_of_tables_));
+    put(bytes, uint32_t(0));
+    put(bytes, uint64_t(num_of_buckets_));
+    bytes.append(reinterpret_cast<const char*>(open_), sizeof(int64_t) * row_size);
+    bytes.append(reinterpret_cast<const char*>(occupied_), sizeof(int64_t) * cells);
+    bytes.append(reinterpret_cast<const char*>(revenue_), sizeof(int64_t) * cells);
+    write_file_atomically(path, bytes);
+}
+size_t Occupancy_Index::bucket_(Minutes time) const
+{
+    check_bucket_boundary(Time::from_minutes(time), bucket_minutes_);
+    Minutes bucket = std::clamp(floor_div(time - origin_, bucket_minutes_), Minutes(0), Minutes(num_of_buckets_));
+    return size_t(bucket);
+}
+int64_t Occupancy_Index::sum_(const int64_t* prefix, int first_table, int end_table, size_t first, size_t end) const
+{
+    size_t row_size = num_of_buckets_ + 1;
+    const int64_t* top = prefix + size_t(first_table) * row_size;
+    const int64_t* bottom = prefix + size_t(end_table) * row_size;
+    return bottom[end] - bottom[first] - top[end] + top[first];
+}
+Occupancy_Totals Occupancy_Index::query(int first_table, int last_table, const Time& from, const Time& to) const
+{
+    size_t first = bucket_(from.minutes);
+    size_t end = std::max(bucket_(to.minutes), first);
+    first_table = std::max(first_table, 1);
+    last_table = std::min(last_table, num_of_tables_);
+
+    Occupancy_Totals totals;
+    if (first_table > last_table) {
+        return totals;
+    }
+    totals.occupied_minutes = sum_(occupied_, first_table - 1, last_table, first, end);
+    totals.revenue = sum_(revenue_, first_table - 1, last_table, first, end);
+    totals.open_minutes = (last_table - first_table + 1) * (open_[end] - open_[first]);
+    return totals;
+}
+
+bool run_occupancy_query(const std::string& index_path, const Occupancy_Query& query, Output_Sink& output)
+{
+    std::vector<std::string> rows;
+    try {
+        Occupancy_Index index(index_path);
+        std::vector<std::pair<int, int>> runs = table_runs(query.tables, index.num_of_tables());
+        auto totals_over = [&](const Time& from, const Time& to) {
+            Occupancy_Totals totals;
+            for (const auto& [first_table, last_table] : runs) {
+                totals += index.query(first_table, last_table, from, to);
+            }
+            return totals;
+        };
+
+        int64_t first_day = index.begin().day();
+        int64_t last_day = std::max(index.end().minutes - 1, index.begin().minutes) / minutes_per_day;
+        if (query.from.empty() && query.to.empty() && !query.hourly) {
+            rows.push_back(format_row(format_range(index.begin(), index.end()), totals_over(index.begin(), index.end())));
+        } else if (query.hourly) {
+            if (!query.from.empty() || !query.to.empty()) {
+                throw std::runtime_error("Error: an hourly query covers the whole timeline, it takes no range");
+            }
+            for (int hour = 0; hour < 24; ++hour) {
+                Occupancy_Totals totals;
+                for (int64_t day = first_day; day <= last_day; ++day) {
+                    Time from = Time::from_minutes(day * minutes_per_day + hour * 60);
+                    totals += totals_over(from, from + Time(1, 0));
+                }
+                if (totals.open_minutes > 0) {
+                    rows.push_back(format_row(format_hours(hour, hour + 1), totals));
+                }
+            }
+        } else {
+            bool from_dated;
+            bool to_dated;
+            Time from = parse_query_time(query.from, from_dated);
+            Time to = parse_query_time(query.to, to_dated);
+            if (from_dated != to_dated) {
+                throw std::runtime_error("Error: a query range is either two times of day or two dated times");
+            }
+            if (from_dated) {
+                rows.push_back(format_row(format_range(from, to), totals_over(from, to)));
+            } else {
+                // the same window on every day, past midnight if it wraps
+                check_bucket_boundary(from, index.bucket_minutes());
+                check_bucket_boundary(to, index.bucket_minutes());
+                Minutes length = to.minutes > from.minutes ? to.minutes - from.minutes : to.minutes + minutes_per_day - from.minutes;
+                Occupancy_Totals total;
+                for (int64_t day = std::max(first_day - 1, int64_t(0)); day <= last_day; ++day) {
+                    Time start = Time::from_minutes(day * minutes_per_day) + from;
+                    Time window_end = start + Time::from_minutes(length);
+                    Occupancy_Totals totals = totals_over(start, window_end);
+                    if (totals.open_minutes > 0) {
+                        // an undated day has no date to carry past midnight
+                        rows.push_back(format_row(format_range(start, start.dated() ? window_end : window_end.time_of_day()), totals));
+                        total += totals;
+                    }
+                }
+                rows.push_back(format_row("total", total));
+            }
+        }
+    } catch (const std::exception& e) {
+        output.write_line(e.what());
+        return false;
+    }
+
+    char header[128];
+    int size = std::snprintf(header, sizeof(header), "%-35s %10s %12s %12s", "range", "occupied", "revenue", "utilization");
+    output.write_line(std::string_view(header, size_t(size)));
+    for (const std::string& row : rows) {
+        output.write_line(row);
+    }
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef RECRUITMENT_TEST_OCCUPANCY_INDEX_H
+#define RECRUITMENT_TEST_OCCUPANCY_INDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Computer_Club_STRUCTS.h"
+#include "mapped_file.h"
+#include "output_sink.h"
+
+// Where a single club run writes its occupancy index, and how long a bucket
+// is. An empty path writes none.
+struct Index_Options {
+    std::string path;
+    Minutes bucket_minutes = 15;
+};
+
+// true if buckets of bucket_minutes split an hour evenly, so every whole hour
+// (as --hourly and HH:MM windows on the hour ask for) is a bucket boundary
+bool is_valid_bucket_length(Minutes bucket_minutes);
+
+struct Occupancy_Totals {
+    Minutes occupied_minutes = 0; // summed over the tables
+    int64_t revenue = 0;
+    Minutes open_minutes = 0; // table-minutes the club was open
+};
+
+// Occupied minutes and revenue per table per time bucket, kept as 2D prefix
+// sums (tables x buckets) so the totals of any range of consecutive tables
+// over any range of whole buckets take four lookups. Buckets are aligned to
+// multiples of bucket_minutes on the timeline, so on a day that is a whole
+// number of buckets long they start at the same time every day. Revenue is
+// counted in the bucket the table was paid (freed) in, occupied minutes in
+// the buckets they were spent in.
+//
+// The index file is the header below followed by the three prefix sum
+// arrays as int64, in the byte order of the machine that wrote it. A loaded
+// index reads them straight out of the mapped file, nothing is replayed.
+//   8 bytes magic "CLUBIDX\0", u32 version, u32 byte order mark 0x01020304
+//   i64 origin (minutes, first bucket's start), i64 bucket_minutes
+//   i32 tables, u32 reserved, u64 buckets
+class Occupancy_Index {
+private:
+    Minutes origin_;
+    Minutes bucket_minutes_;
+    int num_of_tables_;
+    size_t num_of_buckets_;
+    // [bucket], [table * (buckets + 1) + bucket]; sums over everything before
+    const int64_t* open_;
+    const int64_t* occupied_;
+    const int64_t* revenue_;
+    std::vector<int64_t> storage_; // what the arrays point into once built
+    std::unique_ptr<Mapped_File> file_; // or once loaded
+
+    size_t bucket_(Minutes time) const;
+    int64_t sum_(const int64_t* prefix, int first_table, int end_table, size_t first, size_t end) const;
+
+public:
+    Occupancy_Index(const Occupancy_Record& record, int num_of_tables, Minutes bucket_minutes);
+    explicit Occupancy_Index(const std::string& path);
+
+    Occupancy_Index(const Occupancy_Index&) = delete;
+    Occupancy_Index& operator=(const Occupancy_Index&) = delete;
+
+    void save(const std::string& path) const;
+
+    Minutes bucket_minutes() const { return bucket_minutes_; }
+    int num_of_tables() const { return num_of_tables_; }
+    Time begin() const { return Time::from_minutes(origin_); }
+    Time end() const { return Time::from_minutes(origin_ + Minutes(num_of_buckets_) * bucket_minutes_); }
+
+    // totals of tables first_table..last_table (numbers, from 1) over
+    // [from, to), clamped to the indexed timeline; from and to have to be on
+    // bucket boundaries
+    Occupancy_Totals query(int first_table, int last_table, const Time& from, const Time& to) const;
+};
+
+// What run_occupancy_query reports. tables are table numbers, all of them if
+// empty. from and to are both empty, both "HH:MM" (a daily window, it wraps
+// past midnight if to is not after from) or both "YYYY-MM-DD HH:MM".
+struct Occupancy_Query {
+    std::vector<int> tables;
+    std::string from;
+    std::string to;
+    bool hourly = false; // one row per hour of the day, summed over the days
+};
+
+// Loads the index at index_path and writes a header and one row per range:
+//   range occupied revenue utilization
+// A daily window gets a row for every day the club was open in it and a total
+// row. On an error the error message is written instead and false is returned.
+bool run_occupancy_query(const std::string& index_path, const Occupancy_Query& query, Output_Sink& output);
+
+#endif // RECRUITMENT_TEST_OCCUPANCY_INDEX_H
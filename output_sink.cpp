@@ -0,0 +1,393 @@
+#include "output_sink.h"
+#include "spsc_ring.h"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+char* format_int(char* out, int value)
+{
+    return std::to_chars(out, out + max_int_size, value).ptr;
+}
+char* format_duration(char* out, const Time& duration)
+{
+    Minutes hour = duration.hour();
+    int minute = duration.minute();
+    if (hour < 10) {
+        *out++ = '0';
+    }
+    out = std::to_chars(out, out + max_int64_size, hour).ptr;
+    *out++ = ':';
+    *out++ = char('0' + minute / 10);
+    *out++ = char('0' + minute % 10);
+    return out;
+}
+char* format_time(char* out, const Time& time)
+{
+    if (!time.dated()) {
+        return format_duration(out, time);
+    }
+    int64_t year;
+    int month;
+    int day;
+    date_from_ordinal(time.day(), year, month, day);
+    for (int64_t digits = 1000; digits > 1 && year < digits; digits /= 10) {
+        *out++ = '0';
+    }
+    out = std::to_chars(out, out + max_int64_size, year).ptr;
+    *out++ = '-';
+    *out++ = char('0' + month / 10);
+    *out++ = char('0' + month % 10);
+    *out++ = '-';
+    *out++ = char('0' + day / 10);
+    *out++ = char('0' + day % 10);
+    *out++ = ' ';
+    return format_duration(out, time.time_of_day());
+}
+namespace {
+char* format_text(char* out, std::string_view text)
+{
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+// the text of a 13 event is prefix, argument, suffix
+enum class Error_Argument { none, body, client, table };
+struct Error_Text {
+    std::string_view prefix;
+    Error_Argument argument;
+    std::string_view suffix;
+};
+// indexed by Club_Error
+constexpr std::array<Error_Text, 13> error_texts = { {
+    { "", Error_Argument::none, "" },
+    { "Invalid client name: ", Error_Argument::body, "" },
+    { "YouShallNotPass", Error_Argument::none, "" },
+    { "NotOpenYet", Error_Argument::none, "" },
+    { "Error: invalid sit event body: <", Error_Argument::body, ">" },
+    { "Error: table number <", Error_Argument::table, "> is out of range" },
+    { "PlaceIsBusy", Error_Argument::none, "" },
+    { "ClientUnknown", Error_Argument::none, "" },
+    { "ICanWaitNoLonger!", Error_Argument::none, "" },
+    { "Error: client ", Error_Argument::client, " is happily seated and doesn't want to enter the waiting list" },
+    { "Error: client ", Error_Argument::client, " is not seated" },
+    { "Error: unknown event ID", Error_Argument::none, "" },
+    { "Error: event is after closing time", Error_Argument::none, "" },
+} };
+static_assert(error_texts.size() == size_t(Club_Error::after_closing_time) + 1);
+
+size_t max_error_size(const Event_View& event, const Name_Table& names)
+{
+    const Error_Text& text = error_texts[size_t(event.error)];
+    size_t argument_size = 0;
+    switch (text.argument) {
+    case Error_Argument::body:
+        argument_size = event.body.size();
+        break;
+    case Error_Argument::client:
+        argument_size = names.name(event.client).size();
+        break;
+    case Error_Argument::table:
+        argument_size = max_int_size;
+        break;
+    case Error_Argument::none:
+        break;
+    }
+    return text.prefix.size() + argument_size + text.suffix.size();
+}
+char* format_error(char* out, const Event_View& event, const Name_Table& names)
+{
+    const Error_Text& text = error_texts[size_t(event.error)];
+    out = format_text(out, text.prefix);
+    switch (text.argument) {
+    case Error_Argument::body:
+        out = format_text(out, event.body);
+        break;
+    case Error_Argument::client:
+        out = format_text(out, names.name(event.client));
+        break;
+    case Error_Argument::table:
+        out = format_int(out, event.table);
+        break;
+    case Error_Argument::none:
+        break;
+    }
+    return format_text(out, text.suffix);
+}
+}
+
+size_t max_event_size(const Event_View& event, const Name_Table& names)
+{
+    size_t body_size = event.body.size();
+    if (event.generated) {
+        if (event.ID == 13) {
+            body_size = max_error_size(event, names);
+        } else { // client1 or client1 4
+            body_size = names.name(event.client).size() + 1 + max_int_size;
+        }
+    }
+    return max_time_size + max_int_size + 2 + body_size;
+}
+char* format_event(char* out, const Event_View& event, const Name_Table& names)
+{
+    out = format_time(out, event.time);
+    *out++ = ' ';
+    out = format_int(out, event.ID);
+    *out++ = ' ';
+    if (!event.generated) {
+        return format_text(out, event.body);
+    }
+    if (event.ID == 13) {
+        return format_error(out, event, names);
+    }
+    out = format_text(out, names.name(event.client));
+    if (event.table != no_table) {
+        *out++ = ' ';
+        out = format_int(out, event.table);
+    }
+    return out;
+}
+char* format_table(char* out, const Table& table)
+{
+    out = format_int(out, table.number);
+    *out++ = ' ';
+    out = format_int(out, table.revenue);
+    *out++ = ' ';
+    return format_duration(out, table.total_occupied_time);
+}
+
+namespace {
+// appends one formatted line to a std::string, growing it once
+template <typename Format>
+void append_line(std::string& text, size_t max_size, Format format)
+{
+    size_t old_size = text.size();
+    text.resize(old_size + max_size + 1);
+    char* end = format(text.data() + old_size);
+    *end++ = '\n';
+    text.resize(end - text.data());
+}
+}
+
+void Memory_Sink::write_time(const Time& time)
+{
+    append_line(text_, max_time_size, [&](char* out) { return format_time(out, time); });
+}
+void Memory_Sink::write_event(const Event_View& event, const Name_Table& names)
+{
+    append_line(text_, max_event_size(event, names), [&](char* out) { return format_event(out, event, names); });
+}
+void Memory_Sink::write_table(const Table& table)
+{
+    append_line(text_, max_table_size, [&](char* out) { return format_table(out, table); });
+}
+void Memory_Sink::write_line(std::string_view line)
+{
+    text_.append(line);
+    text_.push_back('\n');
+}
+void Memory_Sink::write(std::string_view text)
+{
+    text_.append(text);
+}
+
+// Owns the spare set of blocks and the thread that writes it.
+class Buffered_Sink::Background_Writer {
+private:
+    int fd_;
+    Blocks blocks_;
+    Block_Sizes used_;
+    Spsc_Ring<bool, 1> to_write_; // false stops the thread
+    Spsc_Ring<std::exception_ptr, 1> written_; // what writing failed with, if it did
+    bool busy_;
+    std::thread thread_;
+
+    void write_()
+    {
+        while (to_write_.pop()) {
+            std::exception_ptr error;
+            try {
+                write_blocks_(fd_, blocks_, used_);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            used_.fill(0);
+            written_.push(error);
+        }
+    }
+
+public:
+    explicit Background_Writer(int fd)
+        : fd_(fd)
+        , used_ {}
+        , busy_(false)
+        , thread_(&Background_Writer::write_, this)
+    {
+    }
+    ~Background_Writer()
+    {
+        if (busy_) {
+            written_.pop();
+        }
+        to_write_.push(false);
+        thread_.join();
+    }
+
+    // until the set handed off last is written
+    void wait()
+    {
+        if (busy_) {
+            busy_ = false;
+            std::exception_ptr error = written_.pop();
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+    }
+    // takes the filled blocks, leaving the (written) spare ones in their place
+    void hand_off(Blocks& blocks, Block_Sizes& used)
+    {
+        wait();
+        std::swap(blocks_, blocks);
+        std::swap(used_, used);
+        busy_ = true;
+        to_write_.push(true);
+    }
+};
+
+Buffered_Sink::Buffered_Sink(int fd, bool background_writer)
+    : fd_(fd)
+    , used_ {}
+    , current_(0)
+{
+    blocks_[0].resize(block_size);
+    if (background_writer) {
+        writer_ = std::make_unique<Background_Writer>(fd);
+    }
+}
+Buffered_Sink::~Buffered_Sink()
+{
+    try {
+        flush();
+    } catch (...) {
+        // nowhere left to report a failed write to
+    }
+}
+char* Buffered_Sink::reserve_(size_t size)
+{
+    if (used_[current_] + size > blocks_[current_].size()) {
+        if (used_[current_] > 0) {
+            if (current_ + 1 == block_count && writer_ != nullptr) {
+                writer_->hand_off(blocks_, used_);
+                current_ = 0;
+            } else if (current_ + 1 == block_count) {
+                flush();
+            } else {
+                ++current_;
+            }
+        }
+        // a single line longer than a block gets a block of its own size
+        blocks_[current_].resize(std::max(block_size, size));
+    }
+    return blocks_[current_].data() + used_[current_];
+}
+void Buffered_Sink::commit_(const char* end)
+{
+    used_[current_] = end - blocks_[current_].data();
+}
+void Buffered_Sink::write_time(const Time& time)
+{
+    char* end = format_time(reserve_(max_time_size + 1), time);
+    *end++ = '\n';
+    commit_(end);
+}
+void Buffered_Sink::write_event(const Event_View& event, const Name_Table& names)
+{
+    char* end = format_event(reserve_(max_event_size(event, names) + 1), event, names);
+    *end++ = '\n';
+    commit_(end);
+}
+void Buffered_Sink::write_table(const Table& table)
+{
+    char* end = format_table(reserve_(max_table_size + 1), table);
+    *end++ = '\n';
+    commit_(end);
+}
+void Buffered_Sink::write_line(std::string_view line)
+{
+    char* out = reserve_(line.size() + 1);
+    std::memcpy(out, line.data(), line.size());
+    out[line.size()] = '\n';
+    commit_(out + line.size() + 1);
+}
+void Buffered_Sink::write(std::string_view text)
+{
+    // big chunks (e.g. a whole club report in batch mode) are copied block by block
+    while (!text.empty()) {
+        size_t chunk = std::min(text.size(), block_size);
+        char* out = reserve_(chunk);
+        std::memcpy(out, text.data(), chunk);
+        commit_(out + chunk);
+        text.remove_prefix(chunk);
+    }
+}
+void Buffered_Sink::flush()
+{
+    if (writer_ != nullptr) {
+        writer_->wait(); // what was handed off goes out first
+    }
+    write_blocks_(fd_, blocks_, used_);
+    used_.fill(0);
+    current_ = 0;
+}
+void Buffered_Sink::write_blocks_(int fd, Blocks& blocks, const Block_Sizes& used)
+{
+#ifdef _WIN32
+    for (size_t i = 0; i < block_count; ++i) {
+        size_t written = 0;
+        while (written < used[i]) {
+            int result = _write(fd, blocks[i].data() + written, unsigned(used[i] - written));
+            if (result < 0) {
+                throw std::runtime_error("Error: cannot write output");
+            }
+            written += size_t(result);
+        }
+    }
+#else
+    std::array<iovec, block_count> pending;
+    size_t first = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < block_count; ++i) {
+        if (used[i] > 0) {
+            pending[count++] = { blocks[i].data(), used[i] };
+        }
+    }
+    while (first < count) {
+        ssize_t result = writev(fd, pending.data() + first, int(count - first));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            throw std::runtime_error("Error: cannot write output");
+        }
+        // skip what was fully written, trim the block writev stopped in
+        size_t written = size_t(result);
+        while (first < count && written >= pending[first].iov_len) {
+            written -= pending[first].iov_len;
+            ++first;
+        }
+        if (first < count) {
+            pending[first].iov_base = static_cast<char*>(pending[first].iov_base) + written;
+            pending[first].iov_len -= written;
+        }
+    }
+#endif
+}
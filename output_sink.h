@@ -0,0 +1,107 @@
+#ifndef RECRUITMENT_TEST_OUTPUT_SINK_H
+#define RECRUITMENT_TEST_OUTPUT_SINK_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Computer_Club_STRUCTS.h" // Time, Event_View, Name_Table, Table
+
+// Where a club's report goes. Every call writes one line (write() writes raw
+// text as is); implementations decide how, and whether, it gets formatted.
+// Generated events are typed, so write_event also gets the names to render
+// their clients with.
+class Output_Sink {
+public:
+    virtual ~Output_Sink() = default;
+    virtual void write_time(const Time& time) = 0; // 09:00
+    virtual void write_event(const Event_View& event, const Name_Table& names) = 0; // 09:00 1 client1
+    virtual void write_table(const Table& table) = 0; // 1 70 05:58
+    virtual void write_line(std::string_view line) = 0;
+    virtual void write(std::string_view text) = 0;
+    virtual void flush() { }
+};
+
+// Discards everything without formatting it, to time the simulation alone.
+class Null_Sink : public Output_Sink {
+public:
+    void write_time(const Time&) override { }
+    void write_event(const Event_View&, const Name_Table&) override { }
+    void write_table(const Table&) override { }
+    void write_line(std::string_view) override { }
+    void write(std::string_view) override { }
+};
+
+// Formats lines into a std::string (no locale, no per-line flush).
+class Memory_Sink : public Output_Sink {
+private:
+    std::string text_;
+
+public:
+    void write_time(const Time& time) override;
+    void write_event(const Event_View& event, const Name_Table& names) override;
+    void write_table(const Table& table) override;
+    void write_line(std::string_view line) override;
+    void write(std::string_view text) override;
+
+    const std::string& str() const { return text_; }
+    std::string take() { return std::move(text_); }
+};
+
+// Formats lines into fixed-size blocks and hands all filled blocks to the
+// file descriptor with a single writev() once block_count of them are full,
+// on flush() and on destruction.
+// With a background writer, full sets of blocks are swapped for a spare set
+// and written by a thread of their own while the spare set fills up; only
+// the writing moves, lines are still formatted on the caller's thread.
+// flush() still returns only once everything is written.
+class Buffered_Sink : public Output_Sink {
+private:
+    static constexpr size_t block_size = 64 * 1024;
+    static constexpr size_t block_count = 16;
+    using Blocks = std::array<std::vector<char>, block_count>;
+    using Block_Sizes = std::array<size_t, block_count>;
+    class Background_Writer;
+
+    int fd_;
+    Blocks blocks_;
+    Block_Sizes used_;
+    size_t current_; // block being filled
+    std::unique_ptr<Background_Writer> writer_; // null if writing on this thread
+
+    char* reserve_(size_t size);
+    void commit_(const char* end);
+    static void write_blocks_(int fd, Blocks& blocks, const Block_Sizes& used);
+
+public:
+    explicit Buffered_Sink(int fd, bool background_writer = false);
+    ~Buffered_Sink() override;
+
+    Buffered_Sink(const Buffered_Sink&) = delete;
+    Buffered_Sink& operator=(const Buffered_Sink&) = delete;
+
+    void write_time(const Time& time) override;
+    void write_event(const Event_View& event, const Name_Table& names) override;
+    void write_table(const Table& table) override;
+    void write_line(std::string_view line) override;
+    void write(std::string_view text) override;
+    void flush() override;
+};
+
+// Locale-free formatting into a buffer with enough room, each returns the new end.
+// The sizes are upper bounds on what the matching format_* call writes.
+constexpr size_t max_int_size = 11;
+constexpr size_t max_int64_size = 20;
+constexpr size_t max_duration_size = max_int64_size + 3;
+constexpr size_t max_time_size = max_int64_size + 7 + 5; // 2024-03-01 09:00
+char* format_int(char* out, int value);
+char* format_duration(char* out, const Time& duration); // 09:00, hours not wrapped at a day
+char* format_time(char* out, const Time& time); // 09:00, with the date first if the time has one
+char* format_event(char* out, const Event_View& event, const Name_Table& names);
+char* format_table(char* out, const Table& table);
+size_t max_event_size(const Event_View& event, const Name_Table& names);
+constexpr size_t max_table_size = 2 * max_int_size + max_duration_size + 3;
+
+#endif // RECRUITMENT_TEST_OUTPUT_SINK_H
@@ -0,0 +1,124 @@
+#include "parallel_parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+Parallel_Event_Source::Parallel_Event_Source(std::string_view input, size_t offset, const Parse_Chunking& chunking,
+    std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , input_(input)
+    , offset_(offset)
+    , num_of_threads_(std::max(chunking.num_of_threads, size_t(1)))
+    , min_chunk_size_(std::max(chunking.min_chunk_size, size_t(1)))
+    , parsed_(false)
+    , chunk_(0)
+    , next_event_(0)
+    , position_(offset)
+{
+}
+void Parallel_Event_Source::parse_()
+{
+    // chunk boundaries are just past a '\n', so every chunk holds whole lines
+    size_t size = input_.size() - offset_;
+    size_t num_of_chunks = std::clamp(size / min_chunk_size_, size_t(1), num_of_threads_);
+    std::vector<size_t> starts { offset_ };
+    for (size_t i = 1; i < num_of_chunks; ++i) {
+        size_t line_end = input_.find('\n', std::max(offset_ + i * (size / num_of_chunks), starts.back()));
+        if (line_end == std::string_view::npos) {
+            break;
+        }
+        starts.push_back(line_end + 1);
+    }
+    starts.push_back(input_.size());
+    chunks_.clear();
+    parsed_ = true;
+    if (starts.size() == 2) {
+        rest_ = input_.substr(offset_);
+        return;
+    }
+
+    // the chunks' names are filled on other threads, so they stay off our memory resource
+    chunks_.resize(starts.size() - 1);
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        chunks_[i].source = std::make_unique<Buffer_Event_Source>(input_.substr(0, starts[i + 1]), starts[i]);
+        chunks_[i].source->set_dated(dated_);
+    }
+    auto lex_chunk = [](Chunk& chunk) {
+        try {
+            Event_View event(Time(0, 0), 0, {});
+            while (chunk.source->next(event)) {
+                chunk.events.push_back(event);
+            }
+        } catch (...) {
+            chunk.error = std::current_exception();
+        }
+    };
+    Thread_Pool pool(chunks_.size());
+    for (Chunk& chunk : chunks_) {
+        pool.submit([&chunk, &lex_chunk] { lex_chunk(chunk); });
+    }
+    pool.wait();
+
+    chunk_ = 0;
+    next_event_ = 0;
+    client_ids_.assign(chunks_[0].source->names().size(), no_client);
+}
+bool Parallel_Event_Source::next(Event_View& event)
+{
+    if (!parsed_) {
+        parse_();
+    }
+    if (chunks_.empty()) {
+        std::string_view line;
+        while (next_line(rest_, line)) {
+            if (lex_(line, event)) {
+                position_ = uint64_t(rest_.data() - input_.data());
+                return true;
+            }
+        }
+        return false;
+    }
+    while (next_event_ == chunks_[chunk_].events.size()) {
+        // a chunk's error is the earliest, the chunks after it are never looked at
+        if (chunks_[chunk_].error != nullptr) {
+            chunks_.resize(chunk_ + 1);
+            std::rethrow_exception(std::exchange(chunks_[chunk_].error, nullptr));
+        }
+        if (chunk_ + 1 == chunks_.size()) {
+            return false;
+        }
+        ++chunk_;
+        next_event_ = 0;
+        client_ids_.assign(chunks_[chunk_].source->names().size(), no_client);
+    }
+
+    const Chunk& chunk = chunks_[chunk_];
+    event = chunk.events[next_event_++];
+    if (event.client != no_client) {
+        int& client_id = client_ids_[event.client];
+        if (client_id == no_client) {
+            client_id = names_.intern(chunk.source->names().name(event.client));
+        }
+        event.client = client_id;
+    }
+    // an event's body runs to the end of its line
+    size_t line_end = size_t(event.body.data() + event.body.size() - input_.data());
+    position_ = std::min(line_end + 1, input_.size());
+    return true;
+}
+uint64_t Parallel_Event_Source::position()
+{
+    return position_;
+}
+void Parallel_Event_Source::seek(uint64_t offset)
+{
+    if (offset > input_.size()) {
+        throw std::runtime_error("Error: position is past the end of input");
+    }
+    // whatever was parsed already is dropped, the next call to next() parses from offset
+    offset_ = size_t(offset);
+    position_ = offset;
+    parsed_ = false;
+    chunks_.clear();
+}
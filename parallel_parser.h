@@ -0,0 +1,62 @@
+#ifndef RECRUITMENT_TEST_PARALLEL_PARSER_H
+#define RECRUITMENT_TEST_PARALLEL_PARSER_H
+
+#include <exception>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "parsing_functions.h"
+
+// How Parallel_Event_Source splits its input: into a chunk per thread, but
+// into fewer if the chunks would be smaller than min_chunk_size.
+struct Parse_Chunking {
+    size_t num_of_threads = std::thread::hardware_concurrency();
+    size_t min_chunk_size = 256 * 1024;
+};
+
+// Lexes the events of a whole text log in memory (e.g. a mapped file) on
+// several threads before handing out the first one. The input is split at
+// line ends into one chunk per thread, and each chunk is lexed into an event
+// buffer by a Buffer_Event_Source of its own, with its own names. next()
+// then hands the buffers out in input order, interning a chunk's names as
+// their first event comes by, so client IDs (and checkpoints) come out as a
+// sequential parse gives them. If a line fails to parse, the events before
+// the earliest bad line are handed out, then its error is thrown. Bodies
+// point into the input.
+// Parsing happens on the first call to next(), from wherever seek() left
+// the source; an input too small for two chunks (or a single thread) is
+// lexed line by line as next() goes, like Buffer_Event_Source. Positions
+// are byte offsets into the input.
+class Parallel_Event_Source : public Event_Source {
+private:
+
+    struct Chunk {
+        std::unique_ptr<Buffer_Event_Source> source; // keeps the chunk's names
+        std::vector<Event_View> events; // with the chunk's own client IDs
+        std::exception_ptr error; // of the chunk's first bad line, after events
+    };
+
+    std::string_view input_;
+    size_t offset_; // where parsing starts
+    size_t num_of_threads_;
+    size_t min_chunk_size_;
+    bool parsed_;
+    std::string_view rest_; // with a single chunk: what is left of it, lexed as it is read
+    std::vector<Chunk> chunks_;
+    size_t chunk_; // the chunk next() takes events from
+    size_t next_event_;
+    std::vector<int> client_ids_; // chunk's client ID -> ours, no_client until interned
+    uint64_t position_;
+
+    void parse_();
+
+public:
+    Parallel_Event_Source(std::string_view input, size_t offset, const Parse_Chunking& chunking = {},
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+#endif // RECRUITMENT_TEST_PARALLEL_PARSER_H
@@ -1,4 +1,35 @@
 #include "parsing_functions.h"
+#include "helper_functions.h"
+#include <charconv>
+#include <climits>
+
+namespace {
+bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+bool is_date_prefix(std::string_view text)
+{
+    // 'YYYY-MM-DD ', the digits are checked by lex_date
+    return text.size() > 11 && text[4] == '-' && text[7] == '-' && text[10] == ' ';
+}
+void parse_opening_hours(std::string line, Time& start_time, Time& end_time)
+{
+    // 09:00 21:00, or 2024-03-01 18:00 06:00 for the first of a run of dated shifts
+    int64_t day = 0;
+    if (is_date_prefix(line)) {
+        day = parse_date(std::string_view(line).substr(0, 10));
+        line.erase(0, 11);
+    }
+    start_time = parse_time(line.substr(0, 5));
+    end_time = parse_time(line.substr(6, 5));
+    if (day > 0) {
+        // a shift that doesn't close later the same day closes the next day
+        start_time += Time::from_minutes(day * minutes_per_day);
+        end_time += Time::from_minutes((end_time.minutes > start_time.time_of_day().minutes ? day : day + 1) * minutes_per_day);
+    }
+}
+}
 
 std::ifstream open_input_file(const std::string& filename)
 {
@@ -8,26 +39,157 @@ std::ifstream open_input_file(const std::string& filename)
     }
     return input_file;
 }
-int parse_num_of_tables(std::ifstream& input_file)
+int parse_num_of_tables(std::istream& input_file)
 {
     std::string line;
     std::getline(input_file, line);
     return std::stoi(line);
 }
-Time parse_time(const std::string& time_str)
+bool lex_time(std::string_view time_str, Time& time)
+{
+    // accepts the same language as ^([01]?[0-9]|2[0-3]):[0-5][0-9]$
+    size_t size = time_str.size();
+    if (size != 4 && size != 5) {
+        return false;
+    }
+    if (time_str[size - 3] != ':' || !is_digit(time_str[size - 2]) || !is_digit(time_str[size - 1])) {
+        return false;
+    }
+
+    int hour = 0;
+    for (size_t i = 0; i < size - 3; ++i) {
+        if (!is_digit(time_str[i])) {
+            return false;
+        }
+        hour = hour * 10 + (time_str[i] - '0');
+    }
+    int minute = (time_str[size - 2] - '0') * 10 + (time_str[size - 1] - '0');
+    if (hour > 23 || minute > 59) {
+        return false;
+    }
+
+    time = Time(hour, minute);
+    return true;
+}
+Time parse_time(std::string_view time_str)
 {
-    std::regex time_regex("^([01]?[0-9]|2[0-3]):[0-5][0-9]$");
-    if (!std::regex_match(time_str, time_regex)) {
+    Time time(0, 0);
+    if (!lex_time(time_str, time)) {
         throw std::runtime_error(
-            "Invalid time format: " + time_str);
+            "Invalid time format: " + std::string(time_str));
+    }
+    return time;
+}
+bool lex_date(std::string_view date_str, int64_t& day)
+{
+    // YYYY-MM-DD, a real date from 0001-01-01 on
+    if (date_str.size() != 10 || date_str[4] != '-' || date_str[7] != '-') {
+        return false;
+    }
+    int fields[3] = { 0, 0, 0 };
+    size_t field = 0;
+    for (size_t i = 0; i < date_str.size(); ++i) {
+        if (i == 4 || i == 7) {
+            ++field;
+        } else if (is_digit(date_str[i])) {
+            fields[field] = fields[field] * 10 + (date_str[i] - '0');
+        } else {
+            return false;
+        }
+    }
+    int year = fields[0];
+    int month = fields[1];
+    int month_day = fields[2];
+    if (year < 1 || month < 1 || month > 12 || month_day < 1) {
+        return false;
+    }
+    constexpr int days_in_month[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month_day > days_in_month[month - 1] || (month == 2 && month_day == 29 && !leap)) {
+        return false;
+    }
+
+    day = ordinal_from_date(year, month, month_day);
+    return true;
+}
+int64_t parse_date(std::string_view date_str)
+{
+    int64_t day = 0;
+    if (!lex_date(date_str, day)) {
+        throw std::runtime_error("Invalid date format: " + std::string(date_str));
+    }
+    return day;
+}
+bool lex_event_line(std::string_view line, Time& time, int& ID, std::string_view& body)
+{
+    // same shape as the old (\d{2}:\d{2}) (\d+) (.+) pattern, e.g. '09:00 4 client1'
+    if (line.size() < 9 || !is_digit(line[0]) || !is_digit(line[1]) || line[2] != ':'
+        || !is_digit(line[3]) || !is_digit(line[4]) || line[5] != ' ') {
+        return false;
+    }
+
+    size_t pos = 6;
+    long long id = 0;
+    bool id_overflow = false;
+    while (pos < line.size() && is_digit(line[pos])) {
+        id = id * 10 + (line[pos] - '0');
+        if (id > INT_MAX) {
+            id_overflow = true;
+            id = INT_MAX;
+        }
+        ++pos;
+    }
+    if (pos == 6 || pos + 1 >= line.size() || line[pos] != ' ') {
+        return false;
     }
-    std::string hour_str = time_str.substr(0, 2);
-    std::string minute_str = time_str.substr(3, 2);
-    int hour = std::stoi(hour_str);
-    int minute = std::stoi(minute_str);
-    return { hour, minute };
+
+    // '.' in the old pattern never matched line terminators
+    body = line.substr(pos + 1);
+    if (body.find_first_of("\r\n") != std::string_view::npos) {
+        return false;
+    }
+
+    time = parse_time(line.substr(0, 5));
+    if (id_overflow) {
+        throw std::out_of_range("stoi");
+    }
+    ID = static_cast<int>(id);
+    return true;
+}
+bool lex_dated_event_line(std::string_view line, Time& time, int& ID, std::string_view& body)
+{
+    // '2024-03-01 09:00 4 client1', the rest as lex_event_line has it
+    if (!is_date_prefix(line) || !lex_event_line(line.substr(11), time, ID, body)) {
+        return false;
+    }
+    time += Time::from_minutes(parse_date(line.substr(0, 10)) * minutes_per_day);
+    return true;
 }
-int parse_cost_per_hour(std::ifstream& input_file)
+bool lex_sit_body(std::string_view body, std::string_view& client_name, int& table_number)
+{
+    // ^([a-z0-9_-]+) (\d+)$, e.g. 'client1 4'
+    size_t space = body.find(' ');
+    if (space == std::string_view::npos || space + 1 == body.size()) {
+        return false;
+    }
+    std::string_view name = body.substr(0, space);
+    if (!is_valid_client_name(name)) {
+        return false;
+    }
+
+    long long number = 0;
+    for (size_t i = space + 1; i < body.size(); ++i) {
+        if (!is_digit(body[i])) {
+            return false;
+        }
+        number = std::min(number * 10 + (body[i] - '0'), (long long)(INT_MAX) + 1);
+    }
+
+    client_name = name;
+    table_number = number > INT_MAX ? table_overflow : int(number);
+    return true;
+}
+int parse_cost_per_hour(std::istream& input_file)
 {
     std::string line;
     std::getline(input_file, line);
@@ -36,39 +198,292 @@ int parse_cost_per_hour(std::ifstream& input_file)
 std::vector<Event> parse_events(std::istream& input_stream)
 {
     std::vector<Event> events;
-    std::regex event_regex(
-        R"((\d{2}:\d{2}) (\d+) (.+))"); // 09:00 4 client1
-    std::smatch match;
-    std::string line;
-    while (std::getline(input_stream, line)) {
-        bool valid_event = std::regex_match(line, match, event_regex);
-        if (valid_event) {
-            std::string time_str = match[1];
-            std::string ID = match[2];
-            std::string body = match[3];
-            Time time = parse_time(time_str);
-            int ID_int = std::stoi(ID);
-            events.emplace_back(time, ID_int, body);
-        }
+    Stream_Event_Source source(input_stream);
+    Event_View event(Time(0, 0), 0, {});
+    while (source.next(event)) {
+        events.emplace_back(event.time, event.ID, std::string(event.body));
     }
     return events;
 }
-void parse_input(const std::string& filename, int& num_of_tables, Time& start_time, Time& end_time, int& cost_per_hour, std::vector<Event>& events)
+bool next_line(std::string_view& buffer, std::string_view& line)
 {
-    try {
-        std::ifstream input_file = open_input_file(filename);
-        num_of_tables = parse_num_of_tables(input_file);
+    // std::getline over a buffer: the last line may lack its '\n'
+    if (buffer.empty()) {
+        line = {};
+        return false;
+    }
+    size_t end = buffer.find('\n');
+    if (end == std::string_view::npos) {
+        line = buffer;
+        buffer.remove_prefix(buffer.size()); // keeps pointing at the end of input
+    } else {
+        line = buffer.substr(0, end);
+        buffer.remove_prefix(end + 1);
+    }
+    return true;
+}
+std::vector<Event_View> parse_events(std::string_view buffer)
+{
+    std::vector<Event_View> events;
+    Buffer_Event_Source source(buffer);
+    Event_View event(Time(0, 0), 0, {});
+    while (source.next(event)) {
+        events.push_back(event);
+    }
+    return events;
+}
+void parse_header(std::istream& input_stream, int& num_of_tables, Time& start_time, Time& end_time, int& cost_per_hour)
+{
+    num_of_tables = parse_num_of_tables(input_stream);
+
+    std::string line;
+    std::getline(input_stream, line); // 09:00 21:00
+    parse_opening_hours(line, start_time, end_time);
 
-        std::string line;
-        std::getline(input_file, line); // 09:00 21:00
-        start_time = parse_time(line.substr(0, 5));
-        end_time = parse_time(line.substr(6, 5));
+    cost_per_hour = parse_cost_per_hour(input_stream);
+}
+void parse_header(std::string_view& buffer, int& num_of_tables, Time& start_time, Time& end_time, int& cost_per_hour)
+{
+    std::string_view line;
+
+    next_line(buffer, line);
+    num_of_tables = std::stoi(std::string(line));
 
-        cost_per_hour = parse_cost_per_hour(input_file);
-        events = parse_events(input_file);
-        input_file.close();
-    } catch (const std::exception& e) {
-        std::cout << e.what() << std::endl;
-        exit(1);
+    next_line(buffer, line); // 09:00 21:00
+    parse_opening_hours(std::string(line), start_time, end_time);
+
+    next_line(buffer, line);
+    cost_per_hour = std::stoi(std::string(line));
+}
+bool is_multi_room_log(std::string_view input)
+{
+    return input.starts_with("rooms ");
+}
+void parse_rooms_header(std::string_view& buffer, Time& start_time, Time& end_time, std::vector<Room>& rooms)
+{
+    // space-separated non-negative ints, as many as the line should have
+    auto lex_numbers = [](std::string_view line, std::vector<int>& numbers) {
+        numbers.clear();
+        while (!line.empty()) {
+            int number;
+            auto [end, error] = std::from_chars(line.data(), line.data() + line.size(), number);
+            if (error != std::errc() || end == line.data() || number < 0) {
+                return false;
+            }
+            numbers.push_back(number);
+            line.remove_prefix(size_t(end - line.data()));
+            if (!line.empty()) {
+                if (line.front() != ' ' || line.size() == 1) {
+                    return false;
+                }
+                line.remove_prefix(1);
+            }
+        }
+        return true;
+    };
+
+    std::string_view line;
+    std::vector<int> numbers;
+    next_line(buffer, line);
+    if (!is_multi_room_log(line) || !lex_numbers(line.substr(6), numbers) || numbers.size() != 1 || numbers[0] == 0) {
+        throw std::runtime_error("Error: invalid room count <" + std::string(line) + ">");
+    }
+    int num_of_rooms = numbers[0];
+
+    next_line(buffer, line); // 09:00 21:00
+    parse_opening_hours(std::string(line), start_time, end_time);
+
+    rooms.clear();
+    int64_t first_table = 1;
+    for (int i = 0; i < num_of_rooms; ++i) {
+        if (!next_line(buffer, line) || !lex_numbers(line, numbers) || numbers.size() < 2 || numbers.size() > 3) {
+            throw std::runtime_error("Error: invalid room <" + std::string(line) + ">");
+        }
+        if (first_table + numbers[0] > INT_MAX) {
+            throw std::runtime_error("Error: the rooms have too many tables");
+        }
+        int queue_capacity = numbers.size() == 3 ? numbers[2] : numbers[0];
+        rooms.push_back({ int(first_table), numbers[0], numbers[1], queue_capacity });
+        first_table += numbers[0];
+    }
+}
+bool Event_Source::lex_line_(std::string_view line, Event_View& event) const
+{
+    return dated_ ? lex_dated_event_line(line, event.time, event.ID, event.body)
+                  : lex_event_line(line, event.time, event.ID, event.body);
+}
+bool Event_Source::lex_(std::string_view line, Event_View& event)
+{
+    bool lexed = lex_line_(line, event);
+    if (lexed) {
+        decode_body_(event);
+    }
+    return lexed;
+}
+std::string_view lex_client_name(Event_View& event)
+{
+    event.client = no_client;
+    event.table = no_table;
+    std::string_view client_name = event.body;
+    if (event.ID == 2 || event.ID == 12) {
+        if (lex_sit_body(event.body, client_name, event.table)) {
+            return client_name;
+        }
+    } else if (event.ID == 1 || event.ID == 3 || event.ID == 4 || event.ID == 11) {
+        if (is_valid_client_name(client_name)) {
+            return client_name;
+        }
+    }
+    return {};
+}
+void Event_Source::decode_body_(Event_View& event)
+{
+    std::string_view client_name = lex_client_name(event);
+    if (!client_name.empty()) {
+        event.client = names_.intern(client_name);
+    }
+}
+void Event_Source::restore_names(const Name_Table& names)
+{
+    for (size_t id = 0; id < names.size(); ++id) {
+        names_.intern(names.name(int(id)));
+    }
+}
+Stream_Event_Source::Stream_Event_Source(std::istream& input_stream, std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , input_stream_(input_stream)
+{
+}
+bool Stream_Event_Source::next(Event_View& event)
+{
+    while (std::getline(input_stream_, line_)) {
+        if (lex_(line_, event)) {
+            return true;
+        }
+    }
+    return false;
+}
+uint64_t Stream_Event_Source::position()
+{
+    // tellg() refuses to work once the last line ran into the end of file
+    std::ios::iostate state = input_stream_.rdstate();
+    input_stream_.clear();
+    if (state & std::ios::eofbit) {
+        input_stream_.seekg(0, std::ios::end);
+    }
+    std::streampos position = input_stream_.tellg();
+    input_stream_.setstate(state);
+    if (position < 0) {
+        throw std::runtime_error("Error: input is not seekable, cannot checkpoint it");
+    }
+    return uint64_t(position);
+}
+void Stream_Event_Source::seek(uint64_t offset)
+{
+    input_stream_.clear();
+    if (!input_stream_.seekg(std::streamoff(offset))) {
+        throw std::runtime_error("Error: input is not seekable, cannot resume it");
+    }
+}
+Buffer_Event_Source::Buffer_Event_Source(std::string_view input, size_t offset, std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , input_(input)
+    , buffer_(input.substr(offset))
+{
+}
+uint64_t Buffer_Event_Source::position()
+{
+    return uint64_t(buffer_.data() - input_.data());
+}
+void Buffer_Event_Source::seek(uint64_t offset)
+{
+    if (offset > input_.size()) {
+        throw std::runtime_error("Error: position is past the end of input");
+    }
+    buffer_ = input_.substr(offset);
+}
+bool Buffer_Event_Source::next(Event_View& event)
+{
+    std::string_view line;
+    while (next_line(buffer_, line)) {
+        if (lex_(line, event)) {
+            return true;
+        }
+    }
+    return false;
+}
+void Line_Event_Source::push(std::string_view line)
+{
+    line_ = line;
+    pending_ = true;
+}
+bool Line_Event_Source::next(Event_View& event)
+{
+    if (!pending_) {
+        return false;
+    }
+    pending_ = false;
+    return lex_(line_, event);
+}
+uint64_t Line_Event_Source::position()
+{
+    throw std::runtime_error("Error: pushed events have no position, cannot checkpoint them");
+}
+void Line_Event_Source::seek(uint64_t)
+{
+    throw std::runtime_error("Error: pushed events have no position, cannot resume them");
+}
+void read_events(Event_Source& source, Parsed_Log& log)
+{
+    auto copy_names = [&source, &log] {
+        for (size_t id = log.names.size(); id < source.names().size(); ++id) {
+            log.names.intern(source.names().name(int(id)));
+        }
+    };
+    Event_View event(Time(0, 0), 0, {});
+    try {
+        while (source.next(event)) {
+            log.events.emplace_back(event.time, event.ID, std::string(event.body), event.client, event.table);
+        }
+    } catch (...) {
+        copy_names();
+        throw;
+    }
+    copy_names();
+}
+Parsed_Event_Source::Parsed_Event_Source(const Parsed_Log& log, std::pmr::memory_resource* memory)
+    : Event_Source(memory)
+    , events_(log.events)
+    , subset_(nullptr)
+    , next_(0)
+{
+    restore_names(log.names);
+}
+Parsed_Event_Source::Parsed_Event_Source(const Parsed_Log& log, const std::vector<size_t>& subset,
+    std::pmr::memory_resource* memory)
+    : Parsed_Event_Source(log, memory)
+{
+    subset_ = &subset;
+}
+bool Parsed_Event_Source::next(Event_View& event)
+{
+    size_t size = subset_ == nullptr ? events_.size() : subset_->size();
+    if (next_ == size) {
+        return false;
+    }
+    size_t index = subset_ == nullptr ? next_ : (*subset_)[next_];
+    event = Event_View(events_[index]);
+    ++next_;
+    return true;
+}
+uint64_t Parsed_Event_Source::position()
+{
+    return next_;
+}
+void Parsed_Event_Source::seek(uint64_t offset)
+{
+    if (offset > (subset_ == nullptr ? events_.size() : subset_->size())) {
+        throw std::runtime_error("Error: position is past the end of input");
     }
+    next_ = offset;
 }
@@ -4,15 +4,152 @@
 #include "Computer_Club_STRUCTS.h" // Time, Event, Client, Table
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Pulls events one at a time, so a whole log never has to sit in memory.
+// The body of the returned event is only valid until the next call to next().
+// Bodies are decoded as they are lexed: client names are interned (see
+// names()) and sit events get their table number.
+class Event_Source {
+protected:
+    Name_Table names_;
+    bool dated_ = false;
+
+    void decode_body_(Event_View& event);
+    bool lex_line_(std::string_view line, Event_View& event) const; // time, ID and body only
+    bool lex_(std::string_view line, Event_View& event); // and decode it
+
+public:
+    // names are interned into memory
+    explicit Event_Source(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : names_(memory)
+    {
+    }
+    virtual ~Event_Source() = default;
+    virtual bool next(Event_View& event) = 0;
+    const Name_Table& names() const { return names_; }
+    // lines of a dated log start with their date (see lex_dated_event_line)
+    void set_dated(bool dated) { dated_ = dated; }
+
+    // byte offset in the input where the next call to next() starts reading,
+    // and a way back to it (with the names interned up to there) for checkpoints
+    virtual uint64_t position() = 0;
+    virtual void seek(uint64_t offset) = 0;
+    void restore_names(const Name_Table& names); // into a source that interned none yet
+};
+
+class Stream_Event_Source : public Event_Source {
+private:
+    std::istream& input_stream_;
+    std::string line_;
+
+public:
+    explicit Stream_Event_Source(std::istream& input_stream,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+// reads input from offset on; positions are offsets into the whole input
+class Buffer_Event_Source : public Event_Source {
+private:
+    std::string_view input_;
+    std::string_view buffer_; // what is left to read
+
+public:
+    explicit Buffer_Event_Source(std::string_view input, size_t offset = 0,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+// Events pushed one line at a time (e.g. as they arrive on a socket); next()
+// yields the pushed line if it is an event. Its input has no positions.
+class Line_Event_Source : public Event_Source {
+private:
+    std::string_view line_;
+    bool pending_ = false;
+
+public:
+    using Event_Source::Event_Source;
+    void push(std::string_view line);
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+// A whole log parsed once, for clubs that simulate it again and again (see
+// run_sweep). Client IDs in events index names.
+struct Parsed_Log {
+    int num_of_tables = 0;
+    Time start_time;
+    Time end_time;
+    int cost_per_hour = 0;
+    std::vector<Event> events;
+    Name_Table names;
+};
+
+// Reads every event left in source into log, with the names it interned. If
+// source throws, log keeps the events before the bad line (and their names).
+void read_events(Event_Source& source, Parsed_Log& log);
+
+// Replays the events of a Parsed_Log, which any number of sources (on any
+// number of threads) can share; only the names are copied, up front.
+// Positions are event indexes (into subset, if there is one).
+class Parsed_Event_Source : public Event_Source {
+private:
+    const std::vector<Event>& events_;
+    const std::vector<size_t>* subset_; // null to replay every event
+    size_t next_;
+
+public:
+    explicit Parsed_Event_Source(const Parsed_Log& log,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    // replays only the events at these indexes of log.events, in this order
+    Parsed_Event_Source(const Parsed_Log& log, const std::vector<size_t>& subset,
+        std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    bool next(Event_View& event) override;
+    uint64_t position() override;
+    void seek(uint64_t offset) override;
+};
+
+// One room (hall) of a multi-room venue, with tables, price and waiting
+// queue of its own; tables are numbered across the venue.
+struct Room {
+    int first_table;
+    int num_of_tables;
+    int cost_per_hour;
+    int queue_capacity;
+};
+
 std::ifstream open_input_file(const std::string& filename);
-int parse_num_of_tables(std::ifstream& input_file);
-Time parse_time(const std::string& time_str);
-int parse_cost_per_hour(std::ifstream& input_file);
+int parse_num_of_tables(std::istream& input_file);
+bool lex_time(std::string_view time_str, Time& time);
+Time parse_time(std::string_view time_str);
+bool lex_date(std::string_view date_str, int64_t& day);
+int64_t parse_date(std::string_view date_str);
+bool lex_event_line(std::string_view line, Time& time, int& ID, std::string_view& body);
+bool lex_dated_event_line(std::string_view line, Time& time, int& ID, std::string_view& body);
+bool lex_sit_body(std::string_view body, std::string_view& client_name, int& table_number);
+// the client an event's body names (empty if none) and a sit event's table:
+// all of decoding but the interning
+std::string_view lex_client_name(Event_View& event);
+int parse_cost_per_hour(std::istream& input_file);
+bool next_line(std::string_view& buffer, std::string_view& line);
 std::vector<Event> parse_events(std::istream& input_stream);
-void parse_input(const std::string& filename, int& num_of_tables,
-    Time& start_time, Time& end_time, int& cost_per_hour,
-    std::vector<Event>& events);
+std::vector<Event_View> parse_events(std::string_view buffer);
+void parse_header(std::istream& input_stream, int& num_of_tables,
+    Time& start_time, Time& end_time, int& cost_per_hour);
+void parse_header(std::string_view& buffer, int& num_of_tables,
+    Time& start_time, Time& end_time, int& cost_per_hour);
+// A multi-room log has "rooms <count>" where other logs have their table
+// count, then the opening hours and a line per room, "<tables> <price>" or
+// "<tables> <price> <queue capacity>" (as many as the room has tables if
+// left out). Throws for anything else.
+bool is_multi_room_log(std::string_view input);
+void parse_rooms_header(std::string_view& buffer, Time& start_time, Time& end_time, std::vector<Room>& rooms);
 
 #endif // RECRUITMENT_TEST_PARSING_FUNCTIONS_H
@@ -0,0 +1,53 @@
+#ifndef RECRUITMENT_TEST_SPSC_RING_H
+#define RECRUITMENT_TEST_SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <utility>
+
+// Bounded queue between exactly one producer thread and one consumer thread.
+// The two indexes only ever grow and sit on cache lines of their own, so
+// neither side takes a lock or writes the other's line. push() waits while
+// the ring is full and pop() while it is empty, asleep on the other side's
+// index (C++20 atomic wait) rather than spinning.
+template <typename T, size_t Capacity>
+class Spsc_Ring {
+    static_assert(std::has_single_bit(Capacity), "the capacity has to be a power of two");
+
+private:
+    alignas(64) std::atomic<size_t> head_ { 0 }; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail_ { 0 }; // next slot to push, written by the producer
+    alignas(64) std::array<T, Capacity> slots_ {};
+
+public:
+    void push(T value)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        while (tail - head == Capacity) {
+            head_.wait(head, std::memory_order_acquire);
+            head = head_.load(std::memory_order_acquire);
+        }
+        slots_[tail % Capacity] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        tail_.notify_one();
+    }
+
+    T pop()
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        while (tail == head) {
+            tail_.wait(tail, std::memory_order_acquire);
+            tail = tail_.load(std::memory_order_acquire);
+        }
+        T value = std::move(slots_[head % Capacity]);
+        head_.store(head + 1, std::memory_order_release);
+        head_.notify_one();
+        return value;
+    }
+};
+
+#endif // RECRUITMENT_TEST_SPSC_RING_H
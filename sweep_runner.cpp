@@ -0,0 +1,137 @@
+#include "sweep_runner.h"
+#include "arena.h"
+#include "binary_log.h"
+#include "parallel_parser.h"
+#include "thread_pool.h"
+#include <cstdio>
+
+namespace {
+// Keeps the totals of a club's report and drops the rest.
+class Summary_Sink : public Output_Sink {
+public:
+    int64_t revenue = 0;
+    Minutes occupied_minutes = 0;
+    int64_t table_rows = 0; // one per table per shift
+    uint64_t rejected = 0;
+
+    void write_time(const Time&) override { }
+    void write_event(const Event_View& event, const Name_Table&) override
+    {
+        // the club only makes a client leave (11) when the queue is full
+        if (event.generated && event.ID == 11) {
+            ++rejected;
+        }
+    }
+    void write_table(const Table& table) override
+    {
+        revenue += table.revenue;
+        occupied_minutes += table.total_occupied_time.minutes;
+        ++table_rows;
+    }
+    void write_line(std::string_view) override { }
+    void write(std::string_view) override { }
+};
+
+struct Sweep_Point {
+    Club_Overrides overrides;
+    Summary_Sink summary;
+    std::string error; // empty if the club ran to the end
+};
+
+void load_log(const std::string& filename, size_t num_of_threads, Parsed_Log& log)
+{
+    Mapped_File input(filename);
+    std::unique_ptr<Event_Source> events;
+    if (is_binary_log(input.data())) {
+        parse_binary_header(input.data(), log.num_of_tables, log.start_time, log.end_time, log.cost_per_hour);
+        events = std::make_unique<Binary_Event_Source>(input.data());
+    } else {
+        std::string_view buffer = input.data();
+        parse_header(buffer, log.num_of_tables, log.start_time, log.end_time, log.cost_per_hour);
+        events = std::make_unique<Parallel_Event_Source>(input.data(), buffer.data() - input.data().data(),
+            Parse_Chunking { .num_of_threads = num_of_threads });
+    }
+    events->set_dated(log.start_time.dated());
+    read_events(*events, log);
+}
+
+// the axis, or the one value the log has
+std::vector<std::optional<int>> axis_values(const std::vector<int>& axis)
+{
+    if (axis.empty()) {
+        return { std::nullopt };
+    }
+    return { axis.begin(), axis.end() };
+}
+
+std::string format_row(const Parsed_Log& log, const Sweep_Point& point)
+{
+    int num_of_tables = point.overrides.num_of_tables.value_or(log.num_of_tables);
+    int cost_per_hour = point.overrides.cost_per_hour.value_or(log.cost_per_hour);
+    int queue_capacity = point.overrides.queue_capacity.value_or(num_of_tables);
+    // an undated day that closes before it opens runs past midnight
+    Minutes shift_minutes = log.end_time.minutes - log.start_time.minutes;
+    if (shift_minutes < 0) {
+        shift_minutes += minutes_per_day;
+    }
+    double table_minutes = double(point.summary.table_rows) * double(shift_minutes);
+    double utilization = table_minutes > 0 ? 100.0 * double(point.summary.occupied_minutes) / table_minutes : 0.0;
+
+    char row[128];
+    int size = std::snprintf(row, sizeof(row), "%6d %6d %6d %12lld %11.1f%% %9llu", num_of_tables, cost_per_hour,
+        queue_capacity, static_cast<long long>(point.summary.revenue), utilization,
+        static_cast<unsigned long long>(point.summary.rejected));
+    return std::string(row, size_t(size));
+}
+}
+
+bool run_sweep(const std::string& filename, const Sweep_Grid& grid, size_t num_of_threads,
+    Output_Sink& output)
+{
+    Parsed_Log log;
+    try {
+        load_log(filename, num_of_threads, log);
+    } catch (const std::exception& e) {
+        output.write_line(e.what());
+        return false;
+    }
+
+    std::vector<Sweep_Point> points;
+    for (std::optional<int> num_of_tables : axis_values(grid.tables)) {
+        for (std::optional<int> cost_per_hour : axis_values(grid.prices)) {
+            for (std::optional<int> queue_capacity : axis_values(grid.queue_capacities)) {
+                Club_Overrides overrides { .num_of_tables = num_of_tables, .cost_per_hour = cost_per_hour, .queue_capacity = queue_capacity };
+                points.push_back({ overrides, {}, {} });
+            }
+        }
+    }
+
+    // the log is only read from here on, every club replays the same events
+    Thread_Pool pool(num_of_threads);
+    for (Sweep_Point& point : points) {
+        pool.submit([&log, &point] {
+            thread_local Arena arena;
+            try {
+                Computer_Club club(log, point.overrides, point.summary, &arena);
+                club.simulate();
+                club.print_tables();
+            } catch (const std::exception& e) {
+                point.error = e.what();
+            }
+            arena.reset();
+        });
+    }
+    pool.wait();
+
+    for (const Sweep_Point& point : points) {
+        if (!point.error.empty()) {
+            output.write_line(point.error);
+            return false;
+        }
+    }
+    output.write_line("tables  price  queue      revenue  utilization  rejected");
+    for (const Sweep_Point& point : points) {
+        output.write_line(format_row(log, point));
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef RECRUITMENT_TEST_SWEEP_RUNNER_H
+#define RECRUITMENT_TEST_SWEEP_RUNNER_H
+
+#include <string>
+#include <vector>
+#include "Computer_Club.h"
+#include "output_sink.h"
+
+// The configurations a sweep simulates: every combination of one value from
+// each axis. An empty axis keeps the log's own value (for queue capacities,
+// as many as there are tables).
+struct Sweep_Grid {
+    std::vector<int> tables;
+    std::vector<int> prices;
+    std::vector<int> queue_capacities;
+};
+
+// Parses a log (text or binary) once and simulates every configuration of
+// grid on its events, on a work-stealing thread pool. Writes a header and one
+// row per configuration, tables varying slowest and queue capacity fastest:
+//   tables price queue revenue utilization rejected
+// utilization is the share of table time that was occupied while the club
+// was open, rejected the number of clients who left because the queue was
+// full. On a parse or simulation error the error message is written instead
+// and false is returned.
+bool run_sweep(const std::string& filename, const Sweep_Grid& grid, size_t num_of_threads,
+    Output_Sink& output);
+
+#endif // RECRUITMENT_TEST_SWEEP_RUNNER_H
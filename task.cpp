@@ -1,18 +1,278 @@
-#include "Computer_Club.h"
+#include "arena.h"
+#include "batch_runner.h"
+#include "binary_log.h"
+#include "club_daemon.h"
+#include "instrumentation.h"
+#include "occupancy_index.h"
+#include "sweep_runner.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+namespace {
+void print_usage(const char* program)
+{
+    std::cout << "Usage: " << program << " [--mmap | --pipeline | --parallel-parse] <input_file | ->" << std::endl
+              << "       " << program << " --batch [--mmap] [--jobs N] <input_dir | input_file...>" << std::endl
+              << "       " << program << " --convert <input_file> <binary_log>" << std::endl
+              << "       " << program << " --serve <socket> <input_file>" << std::endl
+              << "       " << program << " --sweep [--jobs N] [--tables LIST] [--prices LIST] [--queue-caps LIST] <input_file>" << std::endl
+              << "       " << program << " --query [--tables LIST] [--hourly] <index_file> [FROM TO]" << std::endl
+              << "Add --null-output to simulate without formatting or writing any output." << std::endl
+              << "Add --metrics FILE to write hot-path metrics to FILE at exit, as Prometheus text if it" << std::endl
+              << "ends in .prom and as JSON otherwise (needs a build with -DCLUB_INSTRUMENTATION=ON)." << std::endl
+              << "A sweep LIST is comma-separated values and ranges FROM-TO[:STEP], e.g. 5,10,20-40:10;" << std::endl
+              << "a list left out keeps the log's value." << std::endl
+              << "A query reports occupancy and revenue over the whole index, FROM-TO as \"HH:MM\" on every" << std::endl
+              << "day or as \"YYYY-MM-DD HH:MM\" once, or with --hourly per hour of the day." << std::endl
+              << "Single club options:" << std::endl
+              << "  --checkpoint FILE         keep a checkpoint of the club's state in FILE" << std::endl
+              << "  --checkpoint-events N     take one every N events" << std::endl
+              << "  --checkpoint-minutes M    take one every M minutes of club time" << std::endl
+              << "  --resume                  continue from the checkpoint in FILE, if any" << std::endl
+              << "  --index FILE              write an occupancy index for --query to FILE" << std::endl
+              << "  --index-bucket M          index in buckets of M minutes, M dividing 60 (default 15)" << std::endl;
+}
+bool write_metrics(const std::string& path)
+{
+    bool prometheus = path.size() >= 5 && path.compare(path.size() - 5, 5, ".prom") == 0;
+    std::ofstream metrics_file(path);
+    metrics_file << (prometheus ? metrics_prometheus() : metrics_json());
+    if (!metrics_file) {
+        std::cout << "Error: cannot write metrics to <" << path << ">" << std::endl;
+        return false;
+    }
+    return true;
+}
+// a non-negative number up to max, false for anything else
+bool parse_count(const std::string& text, long long max, long long& value)
+{
+    size_t used = 0;
+    try {
+        value = std::stoll(text, &used);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return used == text.size() && value >= 0 && value <= max;
+}
+// "5,10,20-40:10" -> 5 10 20 30 40; false if list is anything else
+bool parse_sweep_list(const std::string& list, std::vector<int>& values)
+{
+    values.clear();
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = std::min(list.find(',', start), list.size());
+        std::string item = list.substr(start, end - start);
+        size_t used = 0;
+        int from;
+        int to;
+        int step = 1;
+        try {
+            from = std::stoi(item, &used);
+            to = from;
+            if (used < item.size() && item[used] == '-') {
+                item.erase(0, used + 1);
+                to = std::stoi(item, &used);
+                if (used < item.size() && item[used] == ':') {
+                    item.erase(0, used + 1);
+                    step = std::stoi(item, &used);
+                }
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (used != item.size() || from < 0 || to < from || step < 1) {
+            return false;
+        }
+        for (int64_t value = from; value <= to; value += step) {
+            values.push_back(int(value));
+        }
+        start = end + 1;
+    }
+    return true;
+}
+}
 
 int main(int argc, char* argv[])
 {
-    if (argc != 2) {
-        std::cout << "Usage: " << argv[0] << " <input_file>" << std::endl;
+    bool batch = false;
+    bool convert = false;
+    bool sweep = false;
+    Sweep_Grid grid;
+    bool query = false;
+    Occupancy_Query occupancy_query;
+    Index_Options index;
+    std::string socket_path;
+    std::string metrics_path;
+    bool null_output = false;
+    Input_Mode mode = Input_Mode::Stream;
+    size_t num_of_threads = std::thread::hardware_concurrency();
+    std::vector<std::string> inputs;
+    Checkpoint_Options checkpoints;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (std::strcmp(argv[i], "--sweep") == 0) {
+            sweep = true;
+        } else if (std::strcmp(argv[i], "--tables") == 0 && i + 1 < argc) {
+            if (!parse_sweep_list(argv[++i], grid.tables)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--query") == 0) {
+            query = true;
+        } else if (std::strcmp(argv[i], "--hourly") == 0) {
+            occupancy_query.hourly = true;
+        } else if (std::strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            index.path = argv[++i];
+        } else if (std::strcmp(argv[i], "--index-bucket") == 0 && i + 1 < argc) {
+            long long bucket_minutes;
+            if (!parse_count(argv[++i], INT_MAX, bucket_minutes)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            index.bucket_minutes = Minutes(bucket_minutes);
+        } else if (std::strcmp(argv[i], "--prices") == 0 && i + 1 < argc) {
+            if (!parse_sweep_list(argv[++i], grid.prices)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--queue-caps") == 0 && i + 1 < argc) {
+            if (!parse_sweep_list(argv[++i], grid.queue_capacities)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--convert") == 0) {
+            convert = true;
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--mmap") == 0) {
+            mode = Input_Mode::Memory_Mapped;
+        } else if (std::strcmp(argv[i], "--parallel-parse") == 0) {
+            mode = Input_Mode::Parallel_Parse;
+        } else if (std::strcmp(argv[i], "--pipeline") == 0) {
+            mode = Input_Mode::Pipelined;
+        } else if (std::strcmp(argv[i], "--null-output") == 0) {
+            null_output = true;
+        } else if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            long long jobs;
+            if (!parse_count(argv[++i], 4096, jobs)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            num_of_threads = size_t(jobs);
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoints.path = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-events") == 0 && i + 1 < argc) {
+            long long every_events;
+            if (!parse_count(argv[++i], LLONG_MAX, every_events)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            checkpoints.every_events = uint64_t(every_events);
+        } else if (std::strcmp(argv[i], "--checkpoint-minutes") == 0 && i + 1 < argc) {
+            long long every_minutes;
+            if (!parse_count(argv[++i], INT_MAX, every_minutes)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            checkpoints.every_minutes = Minutes(every_minutes);
+        } else if (std::strcmp(argv[i], "--resume") == 0) {
+            checkpoints.resume = true;
+        } else {
+            inputs.emplace_back(argv[i]);
+        }
+    }
+
+    if (convert) {
+        if (inputs.size() != 2 || batch) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        try {
+            convert_to_binary_log(inputs[0], inputs[1]);
+        } catch (const std::exception& e) {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<Output_Sink> output;
+    if (null_output) {
+        output = std::make_unique<Null_Sink>();
+    } else {
+        // a pipelined club formats its output on its own thread and has it written out on another
+        output = std::make_unique<Buffered_Sink>(fileno(stdout), mode == Input_Mode::Pipelined && !batch);
+    }
+
+    bool checkpointing = !checkpoints.path.empty();
+    bool checkpoint_options = checkpoints.every_events > 0 || checkpoints.every_minutes > 0 || checkpoints.resume;
+    if (checkpoint_options != checkpointing || (checkpointing && batch)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (!metrics_path.empty() && !instrumentation_enabled) {
+        std::cout << "Error: --metrics needs a build with -DCLUB_INSTRUMENTATION=ON" << std::endl;
         return 1;
     }
 
-    Computer_Club club(argv[1]);
+    bool indexing = !index.path.empty();
+    if ((indexing && (batch || checkpoints.resume)) || !is_valid_bucket_length(index.bucket_minutes)) {
+        print_usage(argv[0]);
+        return 1;
+    }
 
-    std::cout << club.get_start_time() << std::endl;
-    club.simulate();
-    std::cout << club.get_end_time() << std::endl;
-    club.print_tables();
+    bool succeeded;
+    if (query) {
+        if ((inputs.size() != 1 && inputs.size() != 3) || batch || checkpointing || indexing) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (inputs.size() == 3) {
+            occupancy_query.from = inputs[1];
+            occupancy_query.to = inputs[2];
+        }
+        occupancy_query.tables = grid.tables;
+        succeeded = run_occupancy_query(inputs[0], occupancy_query, *output);
+    } else if (!socket_path.empty()) {
+        if (inputs.size() != 1 || batch || checkpointing || indexing) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        succeeded = run_daemon(inputs[0], socket_path, *output);
+    } else if (sweep) {
+        if (inputs.size() != 1 || batch || checkpointing || indexing) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        succeeded = run_sweep(inputs[0], grid, num_of_threads, *output);
+    } else if (batch) {
+        std::vector<std::string> filenames = collect_batch_inputs(inputs);
+        if (filenames.empty()) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        succeeded = run_batch(filenames, mode, num_of_threads, *output) == 0;
+    } else {
+        if (inputs.size() != 1) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        Arena arena;
+        succeeded = run_club(inputs[0], mode, *output, checkpoints, &arena, index);
+    }
 
-    return 0;
+    if (!metrics_path.empty() && !write_metrics(metrics_path)) {
+        return 1;
+    }
+    return succeeded ? 0 : 1;
 }
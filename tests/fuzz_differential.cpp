@@ -0,0 +1,321 @@
+// Differential test: every log is run through the club (streamed, mmap'ed,
+// pipelined, parsed in parallel, converted to a binary log and as the one
+// room of a multi-room log) and through the original implementation frozen
+// in reference_club, and the reports have to match byte for byte. The
+// parallel parse cuts even these small logs into several chunks, so chunk
+// boundaries, bad lines in later chunks and names first seen in one are
+// all exercised.
+//
+//   fuzz_differential [--seed S] [--runs N]   N random logs from seed S
+//   fuzz_differential FILE...                 the given logs
+//
+// Built with -DCLUB_LIBFUZZER=ON (clang) it is a libFuzzer target instead.
+// A log that doesn't match is written to fuzz_differential_failure.txt.
+#include "reference_club.h"
+#include "../arena.h"
+#include "../batch_runner.h"
+#include "../binary_log.h"
+#include "../tools/log_generator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+constexpr size_t header_lines = 3;
+// beyond these the original runs out of memory or overflows an int
+constexpr long long max_tables = 4096;
+constexpr long long max_cost_per_hour = 1000;
+// chunks a parallel parse splits a log into, whatever the machine's core count
+constexpr size_t parallel_chunks = 4;
+
+// where check_log() puts the log for the club to read
+const std::string temp_file = (std::filesystem::temp_directory_path()
+    / ("fuzz_differential_" + std::to_string(getpid())))
+                                  .string();
+
+struct Reference_Run {
+    std::string report;
+    size_t bad_line = 0; // of a parse error, 0 if there was none
+    bool failed = false;
+};
+
+Reference_Run run_reference(const std::string& log, bool close_day)
+{
+    Reference_Run run;
+    std::istringstream input(log);
+    std::ostringstream report;
+    try {
+        reference::Computer_Club club(input, report);
+        report << club.get_start_time() << std::endl;
+        club.simulate();
+        if (close_day) {
+            report << club.get_end_time() << std::endl;
+            club.print_tables();
+        }
+    } catch (const reference::Parse_Error& e) {
+        report << e.what() << std::endl;
+        run.bad_line = e.line;
+        run.failed = true;
+    } catch (const std::exception& e) {
+        // a table number or table count the original terminated on, the club reports it
+        report << e.what() << std::endl;
+        run.failed = true;
+    }
+    run.report = report.str();
+    return run;
+}
+
+std::string first_lines(const std::string& log, size_t count)
+{
+    size_t end = 0;
+    for (size_t i = 0; i < count && end < log.size(); ++i) {
+        size_t newline = log.find('\n', end);
+        end = newline == std::string::npos ? log.size() : newline + 1;
+    }
+    return log.substr(0, end);
+}
+
+std::string expected_report(const std::string& log)
+{
+    Reference_Run run = run_reference(log, true);
+    if (run.bad_line <= header_lines) {
+        return run.report;
+    }
+    // The original parsed every event before simulating any, the club streams
+    // them: it writes the report up to the bad line, then the error.
+    Reference_Run before = run_reference(first_lines(log, run.bad_line - 1), false);
+    return before.failed ? before.report : before.report + run.report;
+}
+
+std::string club_report(const std::string& filename, Input_Mode mode)
+{
+    Arena arena;
+    Memory_Sink report;
+    Parse_Chunking chunking { .num_of_threads = parallel_chunks, .min_chunk_size = 1 };
+    run_club(filename, mode, report, {}, &arena, {}, chunking);
+    return report.take();
+}
+
+// logs the original can't be compared on: dated ones are new, and table
+// counts or prices past the limits above
+bool comparable(const std::string& log)
+{
+    std::istringstream input(log);
+    std::string tables;
+    std::string hours;
+    std::string cost;
+    std::getline(input, tables);
+    std::getline(input, hours);
+    std::getline(input, cost);
+    bool dated = hours.size() > 11 && hours[4] == '-' && hours[7] == '-' && hours[10] == ' ';
+    return !dated && std::strtoll(tables.c_str(), nullptr, 10) <= max_tables
+        && std::llabs(std::strtoll(cost.c_str(), nullptr, 10)) <= max_cost_per_hour;
+}
+
+// log with its header as that of a multi-room log with a single room, empty
+// if the header has a table count or price a room line can't have
+std::string as_single_room(const std::string& log)
+{
+    std::istringstream input(log);
+    std::string tables;
+    std::string hours;
+    std::string cost;
+    std::getline(input, tables);
+    std::getline(input, hours);
+    std::getline(input, cost);
+    auto plain_number = [](const std::string& text) {
+        return !text.empty() && text.size() < 10 && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; })
+            && std::to_string(std::stoi(text)) == text;
+    };
+    if (!plain_number(tables) || !plain_number(cost)) {
+        return {};
+    }
+    return "rooms 1\n" + hours + "\n" + tables + " " + cost + "\n" + log.substr(std::min(log.size(), size_t(input.tellg())));
+}
+
+void report_mismatch(const std::string& log, const char* input, const std::string& expected, const std::string& actual)
+{
+    std::ofstream("fuzz_differential_failure.txt", std::ios::binary) << log;
+    std::cout << "Mismatch on the " << input << " input (log in fuzz_differential_failure.txt)" << std::endl
+              << "-- reference:" << std::endl
+              << expected << "-- club:" << std::endl
+              << actual << std::flush;
+}
+
+// runs log through the club every way it can be read, false on the first mismatch
+bool check_log(const std::string& log)
+{
+    if (!comparable(log)) {
+        return true;
+    }
+    std::string text_file = temp_file + ".txt";
+    std::string binary_file = temp_file + ".clb";
+    std::ofstream(text_file, std::ios::binary) << log;
+
+    std::string expected = expected_report(log);
+    std::string actual = club_report(text_file, Input_Mode::Stream);
+    if (actual != expected) {
+        report_mismatch(log, "streamed", expected, actual);
+        return false;
+    }
+    actual = club_report(text_file, Input_Mode::Memory_Mapped);
+    if (actual != expected) {
+        report_mismatch(log, "memory-mapped", expected, actual);
+        return false;
+    }
+    actual = club_report(text_file, Input_Mode::Pipelined);
+    if (actual != expected) {
+        report_mismatch(log, "pipelined", expected, actual);
+        return false;
+    }
+    actual = club_report(text_file, Input_Mode::Parallel_Parse);
+    if (actual != expected) {
+        report_mismatch(log, "parallel-parsed", expected, actual);
+        return false;
+    }
+    try {
+        convert_to_binary_log(text_file, binary_file);
+    } catch (const std::exception&) {
+        return true; // header errors aren't converted
+    }
+    actual = club_report(binary_file, Input_Mode::Stream);
+    if (actual != expected) {
+        report_mismatch(log, "binary", expected, actual);
+        return false;
+    }
+    std::string room_log = as_single_room(log);
+    if (room_log.empty()) {
+        return true;
+    }
+    std::ofstream(text_file, std::ios::binary) << room_log;
+    actual = club_report(text_file, Input_Mode::Stream);
+    if (actual != expected) {
+        report_mismatch(log, "single-room", expected, actual);
+        return false;
+    }
+    return true;
+}
+
+#ifndef CLUB_LIBFUZZER
+// A generated day (rule breaking included), then now and then a few edits
+// that make lines the parser has to skip or reject.
+std::string random_log(std::mt19937_64& random)
+{
+    auto pick = [&random](uint64_t size) { return random() % size; };
+
+    Log_Generator_Options options;
+    options.seed = random();
+    options.tables = int(1 + pick(8));
+    options.clients = int(1 + pick(30));
+    options.cost_per_hour = int(1 + pick(100));
+    options.open_minute = int(pick(24 * 60));
+    options.close_minute = pick(8) == 0 ? int(pick(24 * 60)) : options.open_minute + int(pick(24 * 60 - options.open_minute));
+    options.events = pick(200);
+    options.queue_pressure = double(pick(101)) / 100;
+    options.error_rate = double(pick(31)) / 100;
+    std::string log = generate_log(options);
+
+    std::vector<std::string> lines;
+    std::istringstream input(log);
+    for (std::string line; std::getline(input, line);) {
+        lines.push_back(line);
+    }
+    const std::string alphabet = "0123456789:-_ azAZ!\r\t";
+    const std::string junk[] = { "", " ", "garbage", "9:15 1 early", "12:00 1", "12:00 99999999999 a",
+        "12:00 2 a 99999999999", "12:00 2 a 01", "12:00 2 a  1", "24:00 1 a", "12:60 1 a", "-1", "2147483648" };
+    size_t edits = pick(3) == 0 ? 1 + pick(4) : 0;
+    for (size_t i = 0; i < edits && !lines.empty(); ++i) {
+        std::string& line = lines[pick(lines.size())];
+        switch (pick(5)) {
+        case 0:
+            if (!line.empty()) {
+                line[pick(line.size())] = alphabet[pick(alphabet.size())];
+            }
+            break;
+        case 1:
+            if (!line.empty()) {
+                line.erase(pick(line.size()), 1);
+            }
+            break;
+        case 2:
+            line.insert(pick(line.size() + 1), 1, alphabet[pick(alphabet.size())]);
+            break;
+        case 3:
+            lines.insert(lines.begin() + pick(lines.size() + 1), junk[pick(std::size(junk))]);
+            break;
+        default:
+            std::swap(line, lines[pick(lines.size())]);
+        }
+    }
+
+    log.clear();
+    for (const std::string& line : lines) {
+        log += line;
+        log += '\n';
+    }
+    if (pick(5) == 0 && !log.empty()) {
+        log.pop_back(); // no newline after the last line
+    }
+    return log;
+}
+#endif
+}
+
+#ifdef CLUB_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (!check_log(std::string(reinterpret_cast<const char*>(data), size))) {
+        std::abort();
+    }
+    return 0;
+}
+#else
+int main(int argc, char* argv[])
+{
+    uint64_t seed = 1;
+    uint64_t runs = 1000;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = std::stoull(argv[++i]);
+        } else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = std::stoull(argv[++i]);
+        } else {
+            files.emplace_back(argv[i]);
+        }
+    }
+
+    for (const std::string& file : files) {
+        std::ifstream input(file, std::ios::binary);
+        std::string log((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (!check_log(log)) {
+            return 1;
+        }
+    }
+    if (!files.empty()) {
+        return 0;
+    }
+
+    std::mt19937_64 random(seed);
+    bool matched = true;
+    for (uint64_t run = 0; run < runs && matched; ++run) {
+        matched = check_log(random_log(random));
+        if (!matched) {
+            std::cout << "Seed " << seed << ", run " << run << std::endl;
+        }
+    }
+    std::filesystem::remove(temp_file + ".txt");
+    std::filesystem::remove(temp_file + ".clb");
+    if (matched) {
+        std::cout << runs << " logs match the reference" << std::endl;
+    }
+    return matched ? 0 : 1;
+}
+#endif
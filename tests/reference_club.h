@@ -0,0 +1,203 @@
+#ifndef RECRUITMENT_TEST_REFERENCE_CLUB_H
+#define RECRUITMENT_TEST_REFERENCE_CLUB_H
+
+#include <iostream>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The club as it was first written: regexes, std::string events, a std::queue
+// of clients. It is frozen here as the reference the optimized club is checked
+// against (tests/fuzz_differential.cpp), so don't optimize it. Compared with
+// the original it only
+//   - reads the log from a stream and writes the report to one,
+//   - throws a Parse_Error where the original printed the error and exited,
+//   - keeps the freed table number before the client is erased in
+//     handle_client_leave_table_ (the original read it from the erased client),
+//   - reads single-digit hours ("9:30") right, as the club has done since it
+//     got its lexer (the original made that 09:00).
+namespace reference {
+
+struct Time {
+    int hour;
+    int minute;
+
+    Time(int h, int m)
+        : hour(h)
+        , minute(m)
+    {
+    }
+
+    bool operator<(const Time& other) const
+    {
+        return hour < other.hour || (hour == other.hour && minute < other.minute);
+    }
+
+    bool operator>(const Time& other) const
+    {
+        return hour > other.hour || (hour == other.hour && minute > other.minute);
+    }
+
+    bool operator==(const Time& other) const
+    {
+        return hour == other.hour && minute == other.minute;
+    }
+
+    bool operator<=(const Time& other) const
+    {
+        return *this < other || *this == other;
+    }
+
+    bool operator>=(const Time& other) const
+    {
+        return *this > other || *this == other;
+    }
+
+    Time operator+(const Time& other) const
+    {
+        int total_minutes = (hour * 60 + minute) + (other.hour * 60 + other.minute);
+        int new_hour = total_minutes / 60;
+        int new_minute = total_minutes % 60;
+        return { new_hour, new_minute };
+    }
+
+    // Subtraction operation
+    Time operator-(const Time& other) const
+    {
+        int total_minutes = (hour * 60 + minute) - (other.hour * 60 + other.minute);
+        if (total_minutes < 0) {
+            total_minutes = 0;
+        }
+        int new_hour = total_minutes / 60;
+        int new_minute = total_minutes % 60;
+        return { new_hour, new_minute };
+    }
+
+    Time operator+=(const Time& other)
+    {
+        *this = *this + other;
+        return *this;
+    }
+
+    // print time in HH:MM format
+    friend std::ostream& operator<<(std::ostream& os, const Time& t)
+    {
+        os << (t.hour < 10 ? "0" : "") << t.hour << ":" << (t.minute < 10 ? "0" : "") << t.minute;
+        return os;
+    }
+};
+
+struct Client {
+    std::string name;
+    bool seated;
+    int table_number;
+
+    Client()
+        : name("")
+        , seated(false)
+        , table_number(-1)
+    {
+    }
+
+    Client(std::string n)
+        : name(n)
+        , seated(false)
+        , table_number(-1)
+    {
+    }
+};
+
+struct Table {
+    int number;
+    int revenue;
+    bool occupied;
+    Time occupied_time_start;
+    Time occupied_time_end;
+    Time total_occupied_time;
+
+    Table(int num)
+        : number(num)
+        , revenue(0)
+        , occupied(false)
+        , occupied_time_start(0, 0)
+        , occupied_time_end(0, 0)
+        , total_occupied_time(0, 0)
+    {
+    }
+
+    // operator overloading for printing table info
+    friend std::ostream& operator<<(std::ostream& os, const Table& t)
+    {
+        os << t.number << " " << t.revenue << " " << t.total_occupied_time;
+        return os;
+    }
+};
+
+struct Event {
+    Time time;
+    int ID;
+    std::string body;
+
+    Event(Time t, int id, std::string b)
+        : time(t)
+        , ID(id)
+        , body(b)
+    {
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const Event& e)
+    {
+        // '12:48 1 client1 14' format
+        os << e.time << " " << e.ID << " " << e.body;
+        return os;
+    }
+};
+
+// What the original printed before exiting, and the log line (from 1) that
+// made it fail.
+struct Parse_Error : std::runtime_error {
+    size_t line;
+
+    Parse_Error(const std::string& message, size_t l)
+        : std::runtime_error(message)
+        , line(l)
+    {
+    }
+};
+
+class Computer_Club {
+private:
+    std::unordered_map<std::string, Client> clients_;
+    std::vector<Table> tables_;
+    std::queue<Client> waiting_list_;
+    Time start_time_;
+    Time end_time_;
+    int cost_per_hour_;
+    std::vector<Event> events_;
+    std::ostream& output_;
+
+    std::optional<Event> handle_client_arrival_(const Time& arrival_time, const std::string& event_body);
+    std::optional<Event> handle_client_sit_(const Time& event_time, const std::string& event_body);
+    std::optional<Event> handle_client_start_waiting_(const Time& event_time, const std::string& event_body);
+    std::optional<Event> handle_client_leave_table_(const Time& event_time, const std::string& event_body);
+    void handle_client_leave_(const Time& event_time, const std::string& event_body);
+
+    std::optional<Event> handle_event_(Event& event);
+    void process_events_(std::vector<Event>& events);
+    void initialize_tables_(int num_of_tables);
+
+public:
+    // throws Parse_Error
+    Computer_Club(std::istream& input, std::ostream& output);
+    void simulate();
+    Time get_start_time() const { return start_time_; }
+    Time get_end_time() const { return end_time_; }
+    void print_tables();
+};
+
+}
+
+#endif // RECRUITMENT_TEST_REFERENCE_CLUB_H
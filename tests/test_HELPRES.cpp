@@ -1,6 +1,24 @@
 #include <gtest/gtest.h>
 #include "../Computer_Club_STRUCTS.h"
 #include "../helper_functions.h"
+#include "../output_sink.h"
+#include "../checkpoint.h"
+#include "../arena.h"
+#include "../occupancy_index.h"
+#include "../spsc_ring.h"
+#include "../thread_pool.h"
+#include "../batch_runner.h"
+#include "../tools/log_generator.h"
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <unistd.h>
 
 TEST(ValidClientName, name_with_lowercase_letters)
 {
@@ -42,88 +60,529 @@ TEST(ValidClientName, name_with_space)
     ASSERT_FALSE(is_valid_client_name("cli ent"));
 }
 
+TEST(ValidClientName, long_names_checked_in_blocks)
+{
+    ASSERT_TRUE(is_valid_client_name("abcdefghijklmnopqrstuvwxyz_0123456789-"));
+    ASSERT_FALSE(is_valid_client_name("abcdefghijklmnoPqrstuvwxyz_0123456789-"));
+    ASSERT_FALSE(is_valid_client_name("abcdefghijklmnopqrstuvwxyz_0123456789/"));
+    ASSERT_FALSE(is_valid_client_name("abcdefghijklmno\xe9pqrstuvwxyz"));
+    ASSERT_FALSE(is_valid_client_name("abcdefghijklmno`pqrstuvwxyz{"));
+}
+
 TEST(FreeTable, table_occupied_for_one_hour)
 {
-    Table table;
-    table.occupied = true;
-    table.occupied_time_start = Time { 10, 0 };
-    free_table(table, Time(11, 0), 100);
-    ASSERT_FALSE(table.occupied);
-    ASSERT_EQ(table.occupied_time_end, Time(11, 0));
-    ASSERT_EQ(table.total_occupied_time, Time(1, 0));
-    ASSERT_EQ(table.revenue, 100);
+    Table_Columns tables(1);
+    occupy_table(tables, 0, Time { 10, 0 });
+    free_table(tables, 0, Time(11, 0), 100);
+    ASSERT_FALSE(tables.occupied(0));
+    ASSERT_EQ(tables.row(0).total_occupied_time, Time(1, 0));
+    ASSERT_EQ(tables.revenue[0], 100);
 }
 TEST(FreeTable, table_occupied_for_half_hour)
 {
-    Table table;
-    table.occupied = true;
-    table.occupied_time_start = Time(10, 0);
-    free_table(table, Time(10, 30), 100);
-    ASSERT_FALSE(table.occupied);
-    ASSERT_EQ(table.occupied_time_end, Time(10, 30));
-    ASSERT_EQ(table.total_occupied_time, Time(0, 30));
-    ASSERT_EQ(table.revenue, 100);
+    Table_Columns tables(1);
+    occupy_table(tables, 0, Time(10, 0));
+    free_table(tables, 0, Time(10, 30), 100);
+    ASSERT_FALSE(tables.occupied(0));
+    ASSERT_EQ(tables.row(0).total_occupied_time, Time(0, 30));
+    ASSERT_EQ(tables.revenue[0], 100);
 }
 TEST(FreeTable, table_occupied_for_one_and_half_hour)
 {
-    Table table;
-    table.occupied = true;
-    table.occupied_time_start = Time { 10, 0 };
-    free_table(table, Time(11, 30), 100);
-    ASSERT_FALSE(table.occupied);
-    ASSERT_EQ(table.occupied_time_end, Time(11, 30));
-    ASSERT_EQ(table.total_occupied_time, Time(1, 30));
-    ASSERT_EQ(table.revenue, 200);
+    Table_Columns tables(1);
+    occupy_table(tables, 0, Time { 10, 0 });
+    free_table(tables, 0, Time(11, 30), 100);
+    ASSERT_FALSE(tables.occupied(0));
+    ASSERT_EQ(tables.row(0).total_occupied_time, Time(1, 30));
+    ASSERT_EQ(tables.revenue[0], 200);
 }
 TEST(FreeTable, table_not_occupied)
 {
-    Table table;
-    table.occupied = false;
-    table.occupied_time_start = Time(10, 0);
-    free_table(table, Time(10, 0), 100);
-    ASSERT_FALSE(table.occupied);
-    ASSERT_EQ(table.occupied_time_end, Time(10, 0));
-    ASSERT_EQ(table.total_occupied_time, Time(0, 0));
-    ASSERT_EQ(table.revenue, 0);
+    Table_Columns tables(1);
+    tables.start[0] = Time(10, 0).minutes;
+    free_table(tables, 0, Time(10, 0), 100);
+    ASSERT_FALSE(tables.occupied(0));
+    ASSERT_EQ(tables.row(0).total_occupied_time, Time(0, 0));
+    ASSERT_EQ(tables.revenue[0], 0);
+}
+TEST(FreeTable, only_freed_table_changes)
+{
+    Table_Columns tables(3);
+    occupy_table(tables, 0, Time(9, 0));
+    occupy_table(tables, 2, Time(9, 0));
+    free_table(tables, 2, Time(10, 1), 10);
+    ASSERT_TRUE(tables.occupied(0));
+    ASSERT_EQ(tables.revenue[0], 0);
+    ASSERT_EQ(tables.revenue[2], 20);
+    ASSERT_EQ(tables.free.free_count, 2);
+}
+
+TEST(FreeTablesAtClose, matches_freeing_tables_one_by_one)
+{
+    // 200 tables: three full 64-table words (vector path) plus a partial one
+    Table_Columns batch(200);
+    Table_Columns one_by_one(200);
+    std::vector<uint64_t> closing(batch.free.words.size(), 0);
+    for (int i = 0; i < 200; ++i) {
+        Time start(9 + i % 7, (i * 13) % 60);
+        batch.revenue[i] = one_by_one.revenue[i] = i;
+        if (i % 3 != 0) {
+            occupy_table(batch, i, start);
+            occupy_table(one_by_one, i, start);
+            closing[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    free_tables_at_close(batch, closing, Time(21, 0), 7);
+    for (int i = 0; i < 200; ++i) {
+        if (one_by_one.occupied(i)) {
+            free_table(one_by_one, i, Time(21, 0), 7);
+        }
+    }
+    ASSERT_EQ(batch.revenue, one_by_one.revenue);
+    ASSERT_EQ(batch.occupied_minutes, one_by_one.occupied_minutes);
+    ASSERT_EQ(batch.free.free_count, 200);
+    ASSERT_EQ(batch.free.words, one_by_one.free.words);
+}
+
+TEST(Time, minute_arithmetic)
+{
+    static_assert(Time(1, 30) + Time(0, 45) == Time(2, 15));
+    static_assert(Time(9, 0) - Time(10, 0) == Time(0, 0));
+    static_assert(Time(23, 59).hour() == 23 && Time(23, 59).minute() == 59);
+    ASSERT_LT(Time(9, 59), Time(10, 0));
+}
+
+TEST(Time, dated_timeline)
+{
+    static_assert(ordinal_from_date(1, 1, 1) == 1);
+    static_assert(ordinal_from_date(2024, 3, 1) - ordinal_from_date(2024, 2, 28) == 2);
+    int64_t year;
+    int month;
+    int day;
+    date_from_ordinal(ordinal_from_date(2000, 2, 29), year, month, day);
+    ASSERT_EQ(year, 2000);
+    ASSERT_EQ(month, 2);
+    ASSERT_EQ(day, 29);
+
+    // across midnight, a stay is still end - start
+    Time evening = Time::from_minutes(ordinal_from_date(2024, 3, 1) * minutes_per_day) + Time(23, 30);
+    Time morning = Time::from_minutes(ordinal_from_date(2024, 3, 2) * minutes_per_day) + Time(1, 0);
+    ASSERT_EQ(morning - evening, Time(1, 30));
+    ASSERT_FALSE(Time(23, 59).dated());
+    ASSERT_TRUE(morning.dated());
+}
+
+TEST(FreeTableSet, all_tables_start_free)
+{
+    Free_Table_Set free_tables(3);
+    ASSERT_TRUE(is_table_available(free_tables));
+    ASSERT_EQ(free_tables.free_count, 3);
+    ASSERT_EQ(free_tables.first(), 0);
+}
+TEST(FreeTableSet, no_table_available_when_all_occupied)
+{
+    Free_Table_Set free_tables(2);
+    free_tables.mark_occupied(0);
+    free_tables.mark_occupied(1);
+    ASSERT_FALSE(is_table_available(free_tables));
+    ASSERT_EQ(free_tables.first(), -1);
+}
+TEST(FreeTableSet, first_free_table_across_words)
+{
+    Free_Table_Set free_tables(200);
+    for (int i = 0; i < 200; ++i) {
+        free_tables.mark_occupied(i);
+    }
+    free_tables.mark_free(150);
+    ASSERT_EQ(free_tables.first(), 150);
+    free_tables.mark_free(70);
+    ASSERT_EQ(free_tables.first(), 70);
+    free_tables.mark_occupied(70);
+    ASSERT_EQ(free_tables.first(), 150);
+    ASSERT_EQ(free_tables.free_count, 1);
+}
+TEST(FreeTableSet, marking_twice_keeps_count)
+{
+    Free_Table_Set free_tables(5);
+    free_tables.mark_occupied(3);
+    free_tables.mark_occupied(3);
+    ASSERT_EQ(free_tables.free_count, 4);
+    free_tables.mark_free(3);
+    free_tables.mark_free(3);
+    ASSERT_EQ(free_tables.free_count, 5);
 }
 
 TEST(RemoveClientFromQueue, client_in_queue)
 {
-    std::queue<Client> waiting_list;
-    waiting_list.push(Client("First"));
-    waiting_list.push(Client("Second"));
-    waiting_list.push(Client("Third"));
-    std::queue<Client> result = remove_client_from_queue(waiting_list, "Second");
+    std::queue<int> waiting_list;
+    waiting_list.push(1);
+    waiting_list.push(2);
+    waiting_list.push(3);
+    std::queue<int> result = remove_client_from_queue(waiting_list, 2);
     ASSERT_EQ(result.size(), 2);
-    ASSERT_EQ(result.front().name, "First");
+    ASSERT_EQ(result.front(), 1);
     result.pop();
-    ASSERT_EQ(result.front().name, "Third");
+    ASSERT_EQ(result.front(), 3);
 }
 
 TEST(RemoveClientFromQueue, client_not_in_queue)
 {
-    std::queue<Client> waiting_list;
-    waiting_list.push(Client("First"));
-    waiting_list.push(Client("Second"));
-    waiting_list.push(Client("Third"));
+    std::queue<int> waiting_list;
+    waiting_list.push(1);
+    waiting_list.push(2);
+    waiting_list.push(3);
 
-    std::queue<Client> result = remove_client_from_queue(waiting_list, "Fourth");
+    std::queue<int> result = remove_client_from_queue(waiting_list, 4);
     ASSERT_EQ(result.size(), 3);
-    ASSERT_EQ(result.front().name, "First");
+    ASSERT_EQ(result.front(), 1);
     result.pop();
-    ASSERT_EQ(result.front().name, "Second");
+    ASSERT_EQ(result.front(), 2);
     result.pop();
-    ASSERT_EQ(result.front().name, "Third");
+    ASSERT_EQ(result.front(), 3);
 }
 
 TEST(RemoveClientFromQueue, empty_queue) {
-    std::queue<Client> waiting_list;
-    std::queue<Client> result = remove_client_from_queue(waiting_list, "Alice");
+    std::queue<int> waiting_list;
+    std::queue<int> result = remove_client_from_queue(waiting_list, 1);
     ASSERT_TRUE(result.empty());
 }
 
+TEST(NameTable, interns_each_name_once)
+{
+    Name_Table names;
+    ASSERT_EQ(names.intern("alice"), 0);
+    ASSERT_EQ(names.intern("bob"), 1);
+    ASSERT_EQ(names.intern("alice"), 0);
+    ASSERT_EQ(names.size(), 2);
+    ASSERT_EQ(names.name(1), "bob");
+}
+
+TEST(ClientExists, only_present_clients_exist)
+{
+    std::vector<Client> clients(2);
+    clients[1].present = true;
+    ASSERT_FALSE(client_exists(clients, 0));
+    ASSERT_TRUE(client_exists(clients, 1));
+    ASSERT_FALSE(client_exists(clients, 2));
+    ASSERT_FALSE(client_exists(clients, no_client));
+}
+
+TEST(WaitingList, keeps_order_after_removal)
+{
+    Waiting_List waiting_list;
+    waiting_list.push(0);
+    waiting_list.push(1);
+    waiting_list.push(2);
+    waiting_list.remove(1);
+    ASSERT_EQ(waiting_list.size(), 2);
+    ASSERT_EQ(waiting_list.pop(), 0);
+    ASSERT_EQ(waiting_list.pop(), 2);
+    ASSERT_TRUE(waiting_list.empty());
+}
+
+TEST(WaitingList, remove_drops_every_entry_of_a_client)
+{
+    Waiting_List waiting_list;
+    waiting_list.push(0);
+    waiting_list.push(1);
+    waiting_list.push(0);
+    waiting_list.remove(0);
+    waiting_list.remove(7);
+    ASSERT_EQ(waiting_list.size(), 1);
+    waiting_list.push(0); // queued again after leaving
+    ASSERT_EQ(waiting_list.pop(), 1);
+    ASSERT_EQ(waiting_list.pop(), 0);
+    ASSERT_TRUE(waiting_list.empty());
+}
+
+TEST(WaitingList, wraps_around_and_compacts)
+{
+    Waiting_List waiting_list;
+    waiting_list.push(0);
+    for (int i = 1; i <= 1000; ++i) {
+        waiting_list.push(i);
+        waiting_list.remove(i);
+    }
+    waiting_list.push(1001);
+    ASSERT_EQ(waiting_list.size(), 2);
+    ASSERT_LT(waiting_list.count, 100);
+    ASSERT_EQ(waiting_list.pop(), 0);
+    ASSERT_EQ(waiting_list.pop(), 1001);
+}
+
+TEST(FormatEvent, generated_events_are_rendered_with_names)
+{
+    Name_Table names;
+    int client = names.intern("client1");
+    Memory_Sink sink;
+    sink.write_event(Event_View(Time(9, 0), 4, "client1", client), names);
+    sink.write_event(Event_View::generated_event(Time(9, 0), 12, client, 3), names);
+    sink.write_event(Event_View::generated_event(Time(9, 5), 11, client), names);
+    sink.write_event(Event_View::error_event(Time(9, 5), Club_Error::table_out_of_range, {}, client, 42), names);
+    sink.write_event(Event_View::error_event(Time(9, 5), Club_Error::client_not_seated, {}, client), names);
+    sink.write_event(Event_View::error_event(Time(9, 5), Club_Error::invalid_sit_body, "client1 x"), names);
+    sink.write_event(Event_View::error_event(Time(9, 5), Club_Error::place_is_busy), names);
+    ASSERT_EQ(sink.str(),
+        "09:00 4 client1\n"
+        "09:00 12 client1 3\n"
+        "09:05 11 client1\n"
+        "09:05 13 Error: table number <42> is out of range\n"
+        "09:05 13 Error: client client1 is not seated\n"
+        "09:05 13 Error: invalid sit event body: <client1 x>\n"
+        "09:05 13 PlaceIsBusy\n");
+}
+
+TEST(FormatEvent, dated_times_start_with_the_date)
+{
+    Name_Table names;
+    Time time = Time::from_minutes(ordinal_from_date(2024, 3, 2) * minutes_per_day) + Time(1, 5);
+    Memory_Sink sink;
+    sink.write_time(time);
+    sink.write_event(Event_View(time, 1, "client1"), names);
+    sink.write_table(Table(1, 260, Time(25, 0))); // a duration, not a date
+    ASSERT_EQ(sink.str(), "2024-03-02 01:05\n2024-03-02 01:05 1 client1\n1 260 25:00\n");
+}
+
+TEST(BufferedSink, writes_the_same_bytes_as_memory_sink)
+{
+    // enough lines to fill the blocks several times over, and lines longer than a block
+    auto write_report = [](Output_Sink& sink) {
+        Name_Table names;
+        int client = names.intern("client1");
+        sink.write_time(Time(9, 0));
+        for (int i = 0; i < 60000; ++i) {
+            sink.write_event(Event_View(Time(9, i % 60), 1 + i % 4, "client1", client), names);
+            sink.write_event(Event_View::error_event(Time(10, 0), Club_Error::place_is_busy), names);
+            sink.write_table(Table(i, i * 10, Time(i / 60, i % 60)));
+            if (i % 20000 == 0) {
+                sink.write_line(std::string(100 * 1024 + i, 'l'));
+                sink.write(std::string(300 * 1024, 'w') + "\n");
+            }
+        }
+        sink.write_line("end");
+        sink.flush();
+    };
+    Memory_Sink expected;
+    write_report(expected);
+
+    for (bool background_writer : { false, true }) {
+        std::string path = testing::TempDir() + "buffered_sink_test";
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ASSERT_NE(fd, -1);
+        {
+            Buffered_Sink sink(fd, background_writer);
+            write_report(sink);
+            sink.write_line("after the flush");
+        }
+        ::close(fd);
+
+        std::ifstream input_file(path, std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(input_file)), std::istreambuf_iterator<char>());
+        ASSERT_EQ(contents, expected.str() + "after the flush\n") << "background writer " << background_writer;
+        std::remove(path.c_str());
+    }
+}
+
+TEST(Snapshot, round_trips_values_arrays_and_strings)
+{
+    Snapshot_Writer writer;
+    writer.put(int32_t(-7));
+    writer.put(uint64_t(1) << 40);
+    writer.put_string("client1");
+    writer.put_array(std::vector<Minutes> { 60, 0, 719 });
+
+    Snapshot_Reader reader(writer.bytes());
+    ASSERT_EQ(reader.get<int32_t>(), -7);
+    ASSERT_EQ(reader.get<uint64_t>(), uint64_t(1) << 40);
+    ASSERT_EQ(reader.get_string(), "client1");
+    ASSERT_EQ(reader.get_array<Minutes>(), (std::vector<Minutes> { 60, 0, 719 }));
+    ASSERT_TRUE(reader.at_end());
+}
+
+TEST(Snapshot, rejects_foreign_and_truncated_bytes)
+{
+    Snapshot_Writer writer;
+    writer.put_array(std::vector<int> { 1, 2, 3 });
+    std::string truncated = writer.bytes().substr(0, writer.bytes().size() - 1);
+
+    ASSERT_THROW(Snapshot_Reader("09:00 1 client1"), std::runtime_error);
+    Snapshot_Reader reader(truncated);
+    ASSERT_THROW(reader.get_array<int>(), std::runtime_error);
+}
+
+TEST(Snapshot, atomic_write_replaces_the_file)
+{
+    std::string path = testing::TempDir() + "checkpoint_test";
+    write_file_atomically(path, "first");
+    write_file_atomically(path, "second");
+
+    std::ifstream input_file(path, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(input_file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(contents, "second");
+    std::remove(path.c_str());
+}
+
 int main(int argc, char** argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+TEST(Arena, run_state_is_allocated_from_it_and_reset_keeps_one_block)
+{
+    Arena arena;
+    {
+        Name_Table names(&arena);
+        Waiting_List waiting_list(&arena);
+        Table_Columns tables(300, &arena);
+        for (int i = 0; i < 5000; ++i) {
+            waiting_list.push(names.intern("a_client_name_longer_than_sso_" + std::to_string(i)));
+        }
+        ASSERT_EQ(names.name(4999), "a_client_name_longer_than_sso_4999");
+        ASSERT_EQ(waiting_list.pop(), 0);
+        ASSERT_EQ(tables.size(), 300);
+    }
+    size_t grown = arena.capacity();
+    ASSERT_GT(grown, size_t(64 * 1024));
+
+    arena.reset();
+    ASSERT_EQ(arena.capacity(), grown);
+    void* aligned = arena.allocate(24, 64);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0u);
+    ASSERT_EQ(arena.capacity(), grown); // the same run again needs no new block
+}
+
+TEST(OccupancyIndex, range_queries_match_the_intervals_and_survive_a_reload)
+{
+    // two tables open 09:00-12:00, hourly buckets
+    Occupancy_Record record;
+    record.shifts.emplace_back(Time(9, 0), Time(12, 0));
+    record.intervals.push_back({ 0, Time(9, 30).minutes, Time(10, 30).minutes, 10 });
+    record.intervals.push_back({ 1, Time(9, 0).minutes, Time(11, 10).minutes, 30 });
+    Occupancy_Index built(record, 2, 60);
+
+    std::string path = testing::TempDir() + "occupancy_index_test";
+    built.save(path);
+    Occupancy_Index loaded(path);
+    for (const Occupancy_Index* index : { &built, &loaded }) {
+        Occupancy_Totals all = index->query(1, 2, Time(0, 0), Time(24, 0));
+        ASSERT_EQ(all.occupied_minutes, 60 + 130);
+        ASSERT_EQ(all.revenue, 40);
+        ASSERT_EQ(all.open_minutes, 2 * 180);
+
+        Occupancy_Totals first_hour = index->query(1, 2, Time(9, 0), Time(10, 0));
+        ASSERT_EQ(first_hour.occupied_minutes, 30 + 60);
+        ASSERT_EQ(first_hour.revenue, 0); // revenue counts where the table was paid
+
+        Occupancy_Totals second_table = index->query(2, 2, Time(10, 0), Time(12, 0));
+        ASSERT_EQ(second_table.occupied_minutes, 70);
+        ASSERT_EQ(second_table.revenue, 30);
+        ASSERT_EQ(second_table.open_minutes, 120);
+    }
+    ASSERT_THROW(loaded.query(1, 2, Time(9, 30), Time(10, 0)), std::runtime_error);
+    std::remove(path.c_str());
+}
+
+TEST(OccupancyIndex, buckets_have_to_split_an_hour)
+{
+    Occupancy_Record record;
+    record.shifts.emplace_back(Time(9, 0), Time(12, 0));
+    for (Minutes bucket_minutes : { 1, 5, 15, 60 }) {
+        ASSERT_TRUE(is_valid_bucket_length(bucket_minutes));
+        ASSERT_NO_THROW(Occupancy_Index(record, 2, bucket_minutes));
+    }
+    for (Minutes bucket_minutes : { -15, 0, 7, 45, 120 }) {
+        ASSERT_FALSE(is_valid_bucket_length(bucket_minutes));
+        ASSERT_THROW(Occupancy_Index(record, 2, bucket_minutes), std::runtime_error);
+    }
+}
+
+TEST(SpscRing, hands_values_over_in_order_while_full_and_empty)
+{
+    Spsc_Ring<int, 4> ring;
+    std::thread producer([&ring] {
+        for (int i = 0; i < 10000; ++i) {
+            ring.push(i);
+        }
+    });
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(ring.pop(), i);
+    }
+    producer.join();
+}
+
+TEST(LogGenerator, error_share_tracks_error_rate)
+{
+    // every deliberately wrong event is an error 13 in the report, nothing else is
+    for (double error_rate : { 0.0, 0.1, 0.3 }) {
+        Log_Generator_Options options;
+        options.seed = 7;
+        options.tables = 20;
+        options.clients = 200;
+        options.events = 50000;
+        options.error_rate = error_rate;
+        std::string path = testing::TempDir() + "generated_log_test";
+        std::ofstream(path, std::ios::binary) << generate_log(options);
+
+        Memory_Sink report;
+        ASSERT_TRUE(run_club(path, Input_Mode::Stream, report));
+        std::istringstream lines(report.str());
+        std::string line;
+        int errors = 0;
+        while (std::getline(lines, line)) {
+            errors += line.size() > 9 && line[2] == ':' && line.compare(5, 4, " 13 ") == 0;
+        }
+        ASSERT_NEAR(double(errors) / options.events, error_rate, 0.01) << "error_rate " << error_rate;
+        std::remove(path.c_str());
+    }
+}
+
+TEST(ThreadPool, wait_returns_once_every_task_has_finished)
+{
+    for (size_t num_of_threads : { 0, 1, 4 }) {
+        Thread_Pool pool(num_of_threads);
+        ASSERT_EQ(pool.size(), std::max<size_t>(num_of_threads, 1));
+        std::atomic<int> finished = 0;
+        for (int i = 0; i < 200; ++i) {
+            pool.submit([&finished, i] {
+                if (i % 50 == 0) { // a few long tasks for the others to be stolen around
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+                ++finished;
+            });
+        }
+        pool.wait();
+        ASSERT_EQ(finished, 200);
+    }
+}
+
+TEST(RunBatch, reports_stay_in_input_order_with_uneven_clubs)
+{
+    // the first club is much longer than the rest, one file is broken
+    std::filesystem::path dir = std::filesystem::path(testing::TempDir()) / "batch_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directory(dir);
+    for (int i = 0; i < 8; ++i) {
+        Log_Generator_Options options;
+        options.seed = uint64_t(i) + 1;
+        options.events = i == 0 ? 200000 : 100;
+        std::ofstream(dir / ("club" + std::to_string(i) + ".txt"), std::ios::binary) << generate_log(options);
+    }
+    std::ofstream(dir / "club8.txt", std::ios::binary) << "3\n09:00 19:00\n10\n25:00 1 client1\n";
+
+    std::vector<std::string> filenames = collect_batch_inputs({ dir.string() });
+    ASSERT_EQ(filenames.size(), 9u);
+    ASSERT_TRUE(std::is_sorted(filenames.begin(), filenames.end()));
+    ASSERT_EQ(collect_batch_inputs({ filenames[1], filenames[0] }), (std::vector<std::string> { filenames[1], filenames[0] }));
+
+    Memory_Sink expected;
+    for (const std::string& filename : filenames) {
+        Memory_Sink report;
+        run_club(filename, Input_Mode::Stream, report);
+        expected.write_line("== " + filename + " ==");
+        expected.write(report.str());
+    }
+    Memory_Sink batch;
+    ASSERT_EQ(run_batch(filenames, Input_Mode::Stream, 4, batch), 1);
+    ASSERT_EQ(batch.str(), expected.str());
+    std::filesystem::remove_all(dir);
+}
@@ -1,11 +1,15 @@
 #include <gtest/gtest.h>
+#include <regex>
+#include <sstream>
 #include "../parsing_functions.h"
+#include "../binary_log.h"
+#include "../parallel_parser.h"
 
 TEST(ParseTime, valid_time_format) {
     std::string time_str = "12:30";
     Time result = parse_time(time_str);
-    ASSERT_EQ(result.hour, 12);
-    ASSERT_EQ(result.minute, 30);
+    ASSERT_EQ(result.hour(), 12);
+    ASSERT_EQ(result.minute(), 30);
 }
 
 TEST(ParseTime, invalid_time_format) {
@@ -26,22 +30,22 @@ TEST(ParseTime, minute_out_of_range) {
 TEST(ParseTime, leading_zero_in_hour) {
     std::string time_str = "09:30";
     Time result = parse_time(time_str);
-    ASSERT_EQ(result.hour, 9);
-    ASSERT_EQ(result.minute, 30);
+    ASSERT_EQ(result.hour(), 9);
+    ASSERT_EQ(result.minute(), 30);
 }
 
 TEST(ParseTime, leading_zero_in_minute) {
     std::string time_str = "12:05";
     Time result = parse_time(time_str);
-    ASSERT_EQ(result.hour, 12);
-    ASSERT_EQ(result.minute, 5);
+    ASSERT_EQ(result.hour(), 12);
+    ASSERT_EQ(result.minute(), 5);
 }
 
 TEST(ParseTime, leading_zero_in_hour_and_minute) {
     std::string time_str = "09:05";
     Time result = parse_time(time_str);
-    ASSERT_EQ(result.hour, 9);
-    ASSERT_EQ(result.minute, 5);
+    ASSERT_EQ(result.hour(), 9);
+    ASSERT_EQ(result.minute(), 5);
 }
 
 TEST(ParseTime, no_leading_zero) {
@@ -53,12 +57,12 @@ TEST(ParseEvents, valid_events_format) {
         std::istringstream input_file("09:00 4 client1\n18:00 12 client2 4\n");
         std::vector<Event> events = parse_events(input_file);
         ASSERT_EQ(events.size(), 2);
-        ASSERT_EQ(events[0].time.hour, 9);
-        ASSERT_EQ(events[0].time.minute, 0);
+        ASSERT_EQ(events[0].time.hour(), 9);
+        ASSERT_EQ(events[0].time.minute(), 0);
         ASSERT_EQ(events[0].ID, 4);
         ASSERT_EQ(events[0].body, "client1");
-        ASSERT_EQ(events[1].time.hour, 18);
-        ASSERT_EQ(events[1].time.minute, 0);
+        ASSERT_EQ(events[1].time.hour(), 18);
+        ASSERT_EQ(events[1].time.minute(), 0);
         ASSERT_EQ(events[1].ID, 12);
         ASSERT_EQ(events[1].body, "client2 4");
 }
@@ -79,12 +83,393 @@ TEST(ParseEvents, signle_event) {
     std::istringstream input_file("09:00 4 client_ 123\n");
     std::vector<Event> events = parse_events(input_file);
     ASSERT_EQ(events.size(), 1);
-    ASSERT_EQ(events[0].time.hour, 9);
-    ASSERT_EQ(events[0].time.minute, 0);
+    ASSERT_EQ(events[0].time.hour(), 9);
+    ASSERT_EQ(events[0].time.minute(), 0);
     ASSERT_EQ(events[0].ID, 4);
     ASSERT_EQ(events[0].body, "client_ 123");
 }
 
+TEST(ParseTime, single_digit_hour) {
+    std::string time_str = "9:30";
+    Time result = parse_time(time_str);
+    ASSERT_EQ(result.hour(), 9);
+    ASSERT_EQ(result.minute(), 30);
+}
+
+TEST(LexEventLine, splits_time_id_and_body) {
+    Time time(0, 0);
+    int ID = 0;
+    std::string_view body;
+    ASSERT_TRUE(lex_event_line("18:00 12 client2 4", time, ID, body));
+    ASSERT_EQ(time, Time(18, 0));
+    ASSERT_EQ(ID, 12);
+    ASSERT_EQ(body, "client2 4");
+}
+
+TEST(LexEventLine, skips_malformed_lines) {
+    Time time(0, 0);
+    int ID = 0;
+    std::string_view body;
+    ASSERT_FALSE(lex_event_line("9:00 1 client1", time, ID, body));
+    ASSERT_FALSE(lex_event_line("09:00 client1", time, ID, body));
+    ASSERT_FALSE(lex_event_line("09:00 1 ", time, ID, body));
+    ASSERT_FALSE(lex_event_line("09:00 1x client1", time, ID, body));
+    ASSERT_FALSE(lex_event_line("09:00 1 client1\r", time, ID, body));
+    ASSERT_FALSE(lex_event_line("", time, ID, body));
+}
+
+TEST(LexEventLine, invalid_time_throws) {
+    Time time(0, 0);
+    int ID = 0;
+    std::string_view body;
+    try {
+        lex_event_line("24:00 1 client1", time, ID, body);
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        ASSERT_STREQ(e.what(), "Invalid time format: 24:00");
+    }
+}
+
+TEST(LexEventLine, id_overflow_throws) {
+    Time time(0, 0);
+    int ID = 0;
+    std::string_view body;
+    ASSERT_THROW(lex_event_line("09:00 99999999999 client1", time, ID, body), std::out_of_range);
+}
+
+TEST(LexDatedEventLine, adds_the_day_to_the_time) {
+    Time time(0, 0);
+    int ID = 0;
+    std::string_view body;
+    ASSERT_TRUE(lex_dated_event_line("2024-02-29 18:00 1 client2", time, ID, body));
+    ASSERT_EQ(time, Time::from_minutes(ordinal_from_date(2024, 2, 29) * minutes_per_day) + Time(18, 0));
+    ASSERT_EQ(ID, 1);
+    ASSERT_EQ(body, "client2");
+    ASSERT_FALSE(lex_dated_event_line("18:00 1 client2", time, ID, body));
+    ASSERT_THROW(lex_dated_event_line("2023-02-29 18:00 1 client2", time, ID, body), std::runtime_error);
+    ASSERT_THROW(lex_dated_event_line("2024-13-01 18:00 1 client2", time, ID, body), std::runtime_error);
+}
+
+TEST(ParseHeader, dated_overnight_shift_closes_the_next_day) {
+    std::istringstream input("3\n2024-03-01 18:00 02:00\n10\n");
+    int num_of_tables;
+    Time start_time(0, 0);
+    Time end_time(0, 0);
+    int cost_per_hour;
+    parse_header(input, num_of_tables, start_time, end_time, cost_per_hour);
+    int64_t day = ordinal_from_date(2024, 3, 1);
+    ASSERT_EQ(start_time, Time::from_minutes(day * minutes_per_day) + Time(18, 0));
+    ASSERT_EQ(end_time, Time::from_minutes((day + 1) * minutes_per_day) + Time(2, 0));
+    ASSERT_TRUE(start_time.dated());
+}
+
+TEST(LexSitBody, splits_client_and_table) {
+    std::string_view client_name;
+    int table_number = 0;
+    ASSERT_TRUE(lex_sit_body("client1 4", client_name, table_number));
+    ASSERT_EQ(client_name, "client1");
+    ASSERT_EQ(table_number, 4);
+    ASSERT_TRUE(lex_sit_body("client1 99999999999", client_name, table_number));
+    ASSERT_EQ(table_number, table_overflow);
+}
+
+TEST(LexSitBody, rejects_malformed_bodies) {
+    std::string_view client_name;
+    int table_number = 0;
+    ASSERT_FALSE(lex_sit_body("client1", client_name, table_number));
+    ASSERT_FALSE(lex_sit_body("client1 ", client_name, table_number));
+    ASSERT_FALSE(lex_sit_body("client1 4 5", client_name, table_number));
+    ASSERT_FALSE(lex_sit_body("client1 -4", client_name, table_number));
+    ASSERT_FALSE(lex_sit_body("Client1 4", client_name, table_number));
+    ASSERT_FALSE(lex_sit_body(" 4", client_name, table_number));
+}
+
+TEST(ParseEvents, events_point_into_buffer) {
+    std::string_view buffer = "09:00 4 client1\nbad line\n18:00 12 client2 4";
+    std::vector<Event_View> events = parse_events(buffer);
+    ASSERT_EQ(events.size(), 2);
+    ASSERT_EQ(events[0].time, Time(9, 0));
+    ASSERT_EQ(events[0].ID, 4);
+    ASSERT_EQ(events[0].body, "client1");
+    ASSERT_EQ(events[1].body, "client2 4");
+    ASSERT_GE(events[1].body.data(), buffer.data());
+    ASSERT_LT(events[1].body.data(), buffer.data() + buffer.size());
+}
+
+TEST(StreamEventSource, yields_events_one_at_a_time) {
+    std::istringstream input_stream("09:00 1 client1\nbad line\n09:05 2 client1 3\n");
+    Stream_Event_Source source(input_stream);
+    Event_View event(Time(0, 0), 0, {});
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(event.ID, 1);
+    ASSERT_EQ(event.body, "client1");
+    // nothing past the first line has been consumed yet
+    ASSERT_EQ(input_stream.tellg(), 16);
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(event.time, Time(9, 5));
+    ASSERT_EQ(event.body, "client1 3");
+    ASSERT_FALSE(source.next(event));
+}
+
+TEST(BufferEventSource, seeks_back_to_a_position) {
+    std::string_view input = "09:00 1 client1\n09:05 2 client1 3\n09:10 4 client1";
+    Buffer_Event_Source source(input);
+    Event_View event(Time(0, 0), 0, {});
+    ASSERT_TRUE(source.next(event));
+    uint64_t position = source.position();
+    ASSERT_EQ(position, 16);
+    ASSERT_TRUE(source.next(event));
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(source.position(), input.size());
+
+    source.seek(position);
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(event.body, "client1 3");
+}
+
+TEST(StreamEventSource, position_survives_end_of_file) {
+    std::istringstream input_stream("09:00 1 client1\n09:05 4 client1");
+    Stream_Event_Source source(input_stream);
+    Event_View event(Time(0, 0), 0, {});
+    ASSERT_TRUE(source.next(event));
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(source.position(), 31);
+    ASSERT_FALSE(source.next(event));
+
+    source.seek(16);
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(event.ID, 4);
+}
+
+TEST(BinaryLog, replays_the_text_events) {
+    std::istringstream text_log("3\n09:00 19:00\n10\n"
+                                "08:48 1 client1\n"
+                                "bad line\n"
+                                "09:41 2 client1 1\n"
+                                "09:48 2 client1 01\n"
+                                "10:00 1 Client2\n"
+                                "10:59 7 client1\n"
+                                "11:00 4 client1\n");
+    std::stringstream binary_log;
+    convert_to_binary_log(text_log, binary_log);
+    std::string bytes = binary_log.str();
+    ASSERT_TRUE(is_binary_log(bytes));
+
+    int num_of_tables;
+    Time start_time(0, 0);
+    Time end_time(0, 0);
+    int cost_per_hour;
+    parse_binary_header(bytes, num_of_tables, start_time, end_time, cost_per_hour);
+    ASSERT_EQ(num_of_tables, 3);
+    ASSERT_EQ(start_time, Time(9, 0));
+    ASSERT_EQ(end_time, Time(19, 0));
+    ASSERT_EQ(cost_per_hour, 10);
+
+    Binary_Event_Source source(bytes);
+    std::vector<std::string> bodies;
+    std::vector<int> tables;
+    Event_View event(Time(0, 0), 0, {});
+    while (source.next(event)) {
+        bodies.emplace_back(event.body);
+        tables.push_back(event.table);
+    }
+    ASSERT_EQ(bodies, (std::vector<std::string> { "client1", "client1 1", "client1 01", "Client2", "client1", "client1" }));
+    ASSERT_EQ(tables, (std::vector<int> { no_table, 1, 1, no_table, no_table, no_table }));
+    ASSERT_EQ(event.time, Time(11, 0));
+    ASSERT_EQ(event.client, 0);
+}
+
+TEST(BinaryLog, stops_where_the_text_log_failed) {
+    std::istringstream text_log("1\n09:00 19:00\n10\n09:00 1 client1\n25:00 1 client2\n09:10 1 client3\n");
+    std::stringstream binary_log;
+    convert_to_binary_log(text_log, binary_log);
+    std::string bytes = binary_log.str();
+
+    Binary_Event_Source source(bytes);
+    Event_View event(Time(0, 0), 0, {});
+    ASSERT_TRUE(source.next(event));
+    try {
+        source.next(event);
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        ASSERT_STREQ(e.what(), "Invalid time format: 25:00");
+    }
+}
+
+TEST(BinaryLog, rejects_truncated_input) {
+    std::istringstream text_log("1\n09:00 19:00\n10\n09:00 1 client1\n");
+    std::stringstream binary_log;
+    convert_to_binary_log(text_log, binary_log);
+    std::string bytes = binary_log.str();
+
+    ASSERT_THROW(Binary_Event_Source(bytes.substr(0, bytes.size() - 3)), std::runtime_error);
+    ASSERT_THROW(Binary_Event_Source(bytes.substr(0, 20)), std::runtime_error);
+}
+
+TEST(LineEventSource, yields_each_pushed_event_once) {
+    Line_Event_Source source;
+    Event_View event(Time(0, 0), 0, {});
+    ASSERT_FALSE(source.next(event));
+    source.push("09:05 2 client1 3");
+    ASSERT_TRUE(source.next(event));
+    ASSERT_EQ(event.body, "client1 3");
+    ASSERT_EQ(event.table, 3);
+    ASSERT_FALSE(source.next(event));
+    source.push("not an event");
+    ASSERT_FALSE(source.next(event));
+    source.push("24:00 1 client1");
+    ASSERT_THROW(source.next(event), std::runtime_error);
+    ASSERT_THROW(source.position(), std::runtime_error);
+}
+
+TEST(ParsedEventSource, replays_the_parsed_events_with_their_names) {
+    Buffer_Event_Source parser("09:00 1 client1\nnot an event\n09:05 1 client2\n09:10 2 client2 3\n");
+    Parsed_Log log;
+    read_events(parser, log);
+    ASSERT_EQ(log.events.size(), 3);
+    ASSERT_EQ(log.names.size(), 2);
+
+    // every replay starts from the top, with the same client IDs
+    for (int replay = 0; replay < 2; ++replay) {
+        Parsed_Event_Source source(log);
+        Event_View event(Time(0, 0), 0, {});
+        ASSERT_TRUE(source.next(event));
+        ASSERT_TRUE(source.next(event));
+        ASSERT_TRUE(source.next(event));
+        ASSERT_EQ(event.body, "client2 3");
+        ASSERT_EQ(event.table, 3);
+        ASSERT_EQ(source.names().name(event.client), "client2");
+        ASSERT_FALSE(source.next(event));
+        source.seek(1);
+        ASSERT_TRUE(source.next(event));
+        ASSERT_EQ(event.time, Time(9, 5));
+    }
+}
+
+TEST(ParallelEventSource, matches_a_sequential_parse_and_fails_at_the_earliest_bad_line) {
+    // big enough for several chunks, with names that recur across them
+    std::string log;
+    for (int i = 0; i < 100000; ++i) {
+        log += "09:00 " + std::to_string(1 + i % 4) + " client" + std::to_string(i % 5000) + (i % 7 == 0 ? " 2\n" : "\n");
+    }
+    std::string broken = log;
+    broken.insert(broken.find('\n', broken.size() * 3 / 4) + 1, "24:00 1 late\n");
+    broken.insert(broken.find('\n', broken.size() / 2) + 1, "09:99 1 early\n");
+
+    for (const std::string* input : { &log, &broken }) {
+        Buffer_Event_Source sequential(*input);
+        Parallel_Event_Source parallel(*input, 0, { .num_of_threads = 4 });
+        Event_View expected(Time(0, 0), 0, {});
+        Event_View actual(Time(0, 0), 0, {});
+        std::string sequential_error;
+        std::string parallel_error;
+        while (true) {
+            bool more = false;
+            try {
+                more = sequential.next(expected);
+            } catch (const std::runtime_error& e) {
+                sequential_error = e.what();
+            }
+            try {
+                ASSERT_EQ(parallel.next(actual), more);
+            } catch (const std::runtime_error& e) {
+                parallel_error = e.what();
+            }
+            if (!more) {
+                break;
+            }
+            ASSERT_EQ(actual.body.data(), expected.body.data());
+            ASSERT_EQ(actual.client, expected.client);
+            ASSERT_EQ(actual.table, expected.table);
+            ASSERT_EQ(parallel.position(), sequential.position());
+        }
+        ASSERT_EQ(parallel_error, sequential_error);
+        ASSERT_EQ(parallel.names().size(), sequential.names().size());
+    }
+    Parallel_Event_Source parallel(broken, 0, { .num_of_threads = 4 });
+    Event_View event(Time(0, 0), 0, {});
+    try {
+        while (parallel.next(event)) {
+        }
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        ASSERT_STREQ(e.what(), "Invalid time format: 09:99");
+    }
+}
+
+// the regex-based parser that parse_events used to be, kept for comparison
+static std::vector<Event> regex_parse_events(std::istream& input_stream)
+{
+    std::vector<Event> events;
+    std::regex event_regex(R"((\d{2}:\d{2}) (\d+) (.+))");
+    std::regex time_regex("^([01]?[0-9]|2[0-3]):[0-5][0-9]$");
+    std::smatch match;
+    std::string line;
+    while (std::getline(input_stream, line)) {
+        if (std::regex_match(line, match, event_regex)) {
+            std::string time_str = match[1];
+            if (!std::regex_match(time_str, time_regex)) {
+                throw std::runtime_error("Invalid time format: " + time_str);
+            }
+            Time time(std::stoi(time_str.substr(0, 2)), std::stoi(time_str.substr(3, 2)));
+            events.emplace_back(time, std::stoi(match[2]), match[3]);
+        }
+    }
+    return events;
+}
+
+TEST(ParseRoomsHeader, numbers_tables_across_rooms_and_rejects_bad_rooms) {
+    std::string_view buffer = "rooms 3\n09:00 21:00\n8 10\n4 25 2\n0 5\n09:10 1 client1\n";
+    Time start_time(0, 0);
+    Time end_time(0, 0);
+    std::vector<Room> rooms;
+    ASSERT_TRUE(is_multi_room_log(buffer));
+    parse_rooms_header(buffer, start_time, end_time, rooms);
+    ASSERT_EQ(buffer, "09:10 1 client1\n");
+    ASSERT_EQ(start_time, Time(9, 0));
+    ASSERT_EQ(end_time, Time(21, 0));
+    ASSERT_EQ(rooms.size(), 3);
+    EXPECT_EQ(rooms[0].first_table, 1);
+    EXPECT_EQ(rooms[0].queue_capacity, 8);
+    EXPECT_EQ(rooms[1].first_table, 9);
+    EXPECT_EQ(rooms[1].num_of_tables, 4);
+    EXPECT_EQ(rooms[1].cost_per_hour, 25);
+    EXPECT_EQ(rooms[1].queue_capacity, 2);
+    EXPECT_EQ(rooms[2].first_table, 13);
+
+    ASSERT_FALSE(is_multi_room_log("3\n09:00 21:00\n10\n"));
+    for (std::string_view bad : { "rooms 0\n09:00 21:00\n", "rooms 2\n09:00 21:00\n8 10\n",
+             "rooms 1\n09:00 21:00\n8\n", "rooms 1\n09:00 21:00\n8 -10\n", "rooms 1\n09:00 21:00\n8 10 \n" }) {
+        EXPECT_THROW(parse_rooms_header(bad, start_time, end_time, rooms), std::runtime_error) << bad;
+    }
+}
+
+TEST(ParseEvents, lexer_matches_regex) {
+    std::string log;
+    for (int i = 0; i < 20000; ++i) {
+        int minute = i % 1440;
+        log += (minute / 60 < 10 ? "0" : "") + std::to_string(minute / 60) + ":"
+            + (minute % 60 < 10 ? "0" : "") + std::to_string(minute % 60) + " "
+            + std::to_string(i % 4 + 1) + " client" + std::to_string(i % 97)
+            + (i % 4 == 1 ? " " + std::to_string(i % 10 + 1) : "") + "\n";
+        if (i % 50 == 0) {
+            log += "garbage line\n";
+        }
+    }
+
+    std::istringstream regex_input(log);
+    std::vector<Event> regex_events = regex_parse_events(regex_input);
+    std::istringstream lexer_input(log);
+    std::vector<Event> lexer_events = parse_events(lexer_input);
+
+    ASSERT_EQ(regex_events.size(), lexer_events.size());
+    for (size_t i = 0; i < regex_events.size(); ++i) {
+        ASSERT_EQ(regex_events[i].time, lexer_events[i].time);
+        ASSERT_EQ(regex_events[i].ID, lexer_events[i].ID);
+        ASSERT_EQ(regex_events[i].body, lexer_events[i].body);
+    }
+}
+
 
 int main(int argc, char** argv)
 {
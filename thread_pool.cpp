@@ -0,0 +1,100 @@
+#include "thread_pool.h"
+
+Thread_Pool::Thread_Pool(size_t num_of_threads)
+    : queued_(0)
+    , pending_(0)
+    , next_queue_(0)
+    , stopping_(false)
+{
+    if (num_of_threads == 0) {
+        num_of_threads = 1;
+    }
+    for (size_t i = 0; i < num_of_threads; ++i) {
+        queues_.push_back(std::make_unique<Worker_Queue>());
+    }
+    workers_.reserve(num_of_threads);
+    for (size_t i = 0; i < num_of_threads; ++i) {
+        workers_.emplace_back(&Thread_Pool::work_, this, i);
+    }
+}
+Thread_Pool::~Thread_Pool()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+void Thread_Pool::submit(std::function<void()> task)
+{
+    size_t queue = next_queue_++ % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[queue]->mutex);
+        queues_[queue]->tasks.push_back(std::move(task));
+    }
+    {
+        // taken so a worker can't miss the wake-up between its last check and going to sleep
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++queued_;
+        ++pending_;
+    }
+    wake_up_.notify_one();
+}
+void Thread_Pool::wait()
+{
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    all_done_.wait(lock, [this] { return pending_ == 0; });
+}
+bool Thread_Pool::try_pop_(size_t worker, std::function<void()>& task)
+{
+    Worker_Queue& queue = *queues_[worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+bool Thread_Pool::try_steal_(size_t worker, std::function<void()>& task)
+{
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        Worker_Queue& victim = *queues_[(worker + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+void Thread_Pool::work_(size_t worker)
+{
+    std::function<void()> task;
+    while (true) {
+        if (try_pop_(worker, task) || try_steal_(worker, task)) {
+            --queued_;
+            task();
+            task = nullptr;
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            if (--pending_ == 0) {
+                all_done_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        if (stopping_) {
+            return;
+        }
+        wake_up_.wait(lock, [this] { return stopping_ || queued_ > 0; });
+        if (stopping_) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef RECRUITMENT_TEST_THREAD_POOL_H
+#define RECRUITMENT_TEST_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool where every worker has its own task deque. A worker takes
+// its oldest task from the front of its own deque and, when that is empty,
+// steals the newest task from the back of another worker's deque, so long
+// and short tasks even out across cores without a single shared queue.
+// Tasks are started roughly in the order they were submitted, so callers
+// that consume results in submission order (run_batch) get them early.
+class Thread_Pool {
+private:
+    struct Worker_Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker_Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_;
+    std::condition_variable all_done_;
+    std::atomic<size_t> queued_; // submitted but not yet picked up by a worker
+    std::atomic<size_t> pending_; // submitted but not yet finished
+    std::atomic<size_t> next_queue_;
+    bool stopping_;
+
+    bool try_pop_(size_t worker, std::function<void()>& task);
+    bool try_steal_(size_t worker, std::function<void()>& task);
+    void work_(size_t worker);
+
+public:
+    explicit Thread_Pool(size_t num_of_threads = std::thread::hardware_concurrency());
+    ~Thread_Pool();
+
+    Thread_Pool(const Thread_Pool&) = delete;
+    Thread_Pool& operator=(const Thread_Pool&) = delete;
+
+    size_t size() const { return workers_.size(); }
+    void submit(std::function<void()> task);
+    void wait(); // until every submitted task has finished
+};
+
+#endif // RECRUITMENT_TEST_THREAD_POOL_H
@@ -0,0 +1,104 @@
+#include "log_generator.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+void print_usage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [options] [-o output_file]" << std::endl
+              << "  --seed N            random seed (default 1)" << std::endl
+              << "  --tables N          number of tables (default 10)" << std::endl
+              << "  --clients N         distinct client names (default 100)" << std::endl
+              << "  --price N           cost per hour (default 10)" << std::endl
+              << "  --hours HH:MM HH:MM opening hours (default 09:00 21:00)" << std::endl
+              << "  --days N            N dated shifts from 2024-01-01 instead of one undated day" << std::endl
+              << "  --events N          number of event lines (default 1000)" << std::endl
+              << "  --size N[K|M|G]     generate at least this many bytes instead" << std::endl
+              << "  --queue-pressure P  0..1, higher means longer queues (default 0.5)" << std::endl
+              << "  --error-rate P      0..1, share of invalid events (default 0.05)" << std::endl;
+}
+
+int parse_minute(const std::string& text)
+{
+    return std::stoi(text.substr(0, 2)) * 60 + std::stoi(text.substr(3, 2));
+}
+
+uint64_t parse_size(const std::string& text)
+{
+    uint64_t size = std::stoull(text);
+    switch (text.back()) {
+    case 'G':
+    case 'g':
+        return size << 30;
+    case 'M':
+    case 'm':
+        return size << 20;
+    case 'K':
+    case 'k':
+        return size << 10;
+    default:
+        return size;
+    }
+}
+}
+
+int main(int argc, char* argv[])
+{
+    Log_Generator_Options options;
+    const char* output_filename = nullptr;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--seed" && has_value) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--tables" && has_value) {
+                options.tables = std::stoi(argv[++i]);
+            } else if (arg == "--clients" && has_value) {
+                options.clients = std::stoi(argv[++i]);
+            } else if (arg == "--price" && has_value) {
+                options.cost_per_hour = std::stoi(argv[++i]);
+            } else if (arg == "--hours" && i + 2 < argc) {
+                options.open_minute = parse_minute(argv[++i]);
+                options.close_minute = parse_minute(argv[++i]);
+            } else if (arg == "--days" && has_value) {
+                options.days = std::stoi(argv[++i]);
+            } else if (arg == "--events" && has_value) {
+                options.events = std::stoull(argv[++i]);
+            } else if (arg == "--size" && has_value) {
+                options.bytes = parse_size(argv[++i]);
+            } else if (arg == "--queue-pressure" && has_value) {
+                options.queue_pressure = std::stod(argv[++i]);
+            } else if (arg == "--error-rate" && has_value) {
+                options.error_rate = std::stod(argv[++i]);
+            } else if (arg == "-o" && has_value) {
+                output_filename = argv[++i];
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::FILE* output = stdout;
+    if (output_filename != nullptr) {
+        output = std::fopen(output_filename, "wb");
+        if (output == nullptr) {
+            std::cerr << "Error: cannot open output file <" << output_filename << ">" << std::endl;
+            return 1;
+        }
+    }
+
+    generate_log(options, output);
+
+    if (output != stdout) {
+        std::fclose(output);
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "log_generator.h"
+#include "../Computer_Club_STRUCTS.h" // date_from_ordinal
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+namespace {
+class Log_Writer {
+private:
+    std::FILE* file_;
+    std::string* text_;
+    std::string buffer_;
+    uint64_t written_;
+
+public:
+    Log_Writer(std::FILE* file, std::string* text)
+        : file_(file)
+        , text_(text)
+        , written_(0)
+    {
+        buffer_.reserve(1 << 20);
+    }
+
+    ~Log_Writer() { flush(); }
+
+    void line(const std::string& text)
+    {
+        buffer_ += text;
+        buffer_ += '\n';
+        written_ += text.size() + 1;
+        if (buffer_.size() >= (1 << 20)) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (file_ != nullptr) {
+            std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        } else {
+            *text_ += buffer_;
+        }
+        buffer_.clear();
+    }
+
+    uint64_t written() const { return written_; }
+};
+
+std::string format_minute(int minute)
+{
+    std::string text = "00:00";
+    text[0] = char('0' + minute / 600);
+    text[1] = char('0' + minute / 60 % 10);
+    text[3] = char('0' + minute % 60 / 10);
+    text[4] = char('0' + minute % 10);
+    return text;
+}
+
+std::string format_date(int64_t ordinal)
+{
+    int64_t year;
+    int month;
+    int day;
+    date_from_ordinal(ordinal, year, month, day);
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04d-%02d-%02d", int(year), month, day);
+    return text;
+}
+
+uint64_t generate(const Log_Generator_Options& options, Log_Writer& writer)
+{
+    std::mt19937_64 random(options.seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    auto pick = [&random](size_t size) { return size_t(random() % size); };
+
+    int num_of_tables = std::max(options.tables, 1);
+    int num_of_clients = std::max(options.clients, 1);
+    std::vector<std::string> names(num_of_clients);
+    for (int i = 0; i < num_of_clients; ++i) {
+        names[i] = "client" + std::to_string(i);
+    }
+    std::vector<int> seat(num_of_clients, -1);
+    std::vector<int> owner(num_of_tables, -1);
+    std::vector<int> away(num_of_clients), inside, seated; // who is where, in no particular order
+    std::deque<int> waiting;
+    for (int i = 0; i < num_of_clients; ++i) {
+        away[i] = i;
+    }
+    auto take = [&pick](std::vector<int>& from) {
+        size_t index = pick(from.size());
+        int value = from[index];
+        from[index] = from.back();
+        from.pop_back();
+        return value;
+    };
+
+    bool dated = options.days > 0;
+    int64_t first_day = ordinal_from_date(2024, 1, 1);
+    // 'HH:MM' of a minute of the shift, dated logs put the shift's date first
+    auto stamp = [&](uint64_t shift, int minute) {
+        if (!dated) {
+            return format_minute(minute);
+        }
+        return format_date(first_day + int64_t(shift) + minute / 1440) + " " + format_minute(minute % 1440);
+    };
+
+    writer.line(std::to_string(num_of_tables));
+    writer.line((dated ? format_date(first_day) + " " : "") + format_minute(options.open_minute) + " " + format_minute(options.close_minute));
+    writer.line(std::to_string(options.cost_per_hour));
+
+    // events are spread evenly over the opening hours (several per minute for big logs)
+    uint64_t planned = options.bytes > 0 ? options.bytes / 16 + 1 : options.events;
+    int shift_length = options.close_minute - options.open_minute;
+    if (dated && shift_length <= 0) {
+        shift_length += 1440;
+    }
+    int span = std::max(shift_length, 1);
+    uint64_t num_of_shifts = dated ? uint64_t(options.days) : 1;
+    uint64_t shift = 0;
+    uint64_t count = 0;
+    while (options.bytes > 0 ? writer.written() < options.bytes : count < options.events) {
+        uint64_t position = std::min<uint64_t>(count * span * num_of_shifts / planned, span * num_of_shifts - 1);
+        if (position / span != shift) {
+            // the club closed: everyone left
+            shift = position / span;
+            for (int client : inside) {
+                away.push_back(client);
+            }
+            for (int client : seated) {
+                seat[client] = -1;
+                away.push_back(client);
+            }
+            for (int client : waiting) {
+                away.push_back(client);
+            }
+            inside.clear();
+            seated.clear();
+            waiting.clear();
+            std::fill(owner.begin(), owner.end(), -1);
+        }
+        int minute = options.open_minute + int(position % span);
+        std::string time = stamp(shift, minute) + " ";
+        ++count;
+
+        if (chance(random) < options.error_rate) {
+            switch (pick(6)) {
+            case 0:
+                if (options.open_minute > 0) { // nothing comes before a midnight opening
+                    writer.line(stamp(shift, options.open_minute - 1) + " 1 " + names[pick(names.size())]);
+                    break;
+                }
+                [[fallthrough]];
+            case 1:
+                writer.line(time + "1 Invalid!Name");
+                break;
+            case 2:
+                writer.line(time + "4 ghost" + std::to_string(pick(1000)));
+                break;
+            case 3:
+                writer.line(time + "2 " + names[pick(names.size())] + " " + std::to_string(num_of_tables + 1));
+                break;
+            case 4:
+                // a busy table, else a client who isn't inside: never a valid sit
+                if (!seated.empty()) {
+                    int table = seat[seated[pick(seated.size())]];
+                    writer.line(time + "2 " + names[pick(names.size())] + " " + std::to_string(table + 1));
+                } else if (!away.empty()) {
+                    writer.line(time + "2 " + names[away[pick(away.size())]] + " " + std::to_string(pick(num_of_tables) + 1));
+                } else {
+                    writer.line(time + "2 " + names[pick(names.size())] + " " + std::to_string(num_of_tables + 1));
+                }
+                break;
+            default:
+                writer.line(time + "7 " + names[pick(names.size())]);
+            }
+            continue;
+        }
+
+        // mirrors what the club does with each event, so valid events stay valid
+        bool club_full = seated.size() == size_t(num_of_tables);
+        bool arrive = !away.empty() && (inside.empty() || chance(random) < options.queue_pressure);
+        if (arrive) {
+            int client = take(away);
+            inside.push_back(client);
+            writer.line(time + "1 " + names[client]);
+        } else if (!inside.empty() && !club_full) {
+            int client = take(inside);
+            int table = int(pick(num_of_tables));
+            while (owner[table] != -1) {
+                table = (table + 1) % num_of_tables;
+            }
+            owner[table] = client;
+            seat[client] = table;
+            seated.push_back(client);
+            writer.line(time + "2 " + names[client] + " " + std::to_string(table + 1));
+        } else if (!inside.empty() && chance(random) < 0.5) {
+            // the club is full: queue up, or get sent away if the queue is full too
+            int client = take(inside);
+            writer.line(time + "3 " + names[client]);
+            if (waiting.size() == size_t(num_of_tables)) {
+                away.push_back(client);
+            } else {
+                waiting.push_back(client);
+            }
+        } else if (!seated.empty()) {
+            int client = take(seated);
+            int table = seat[client];
+            owner[table] = -1;
+            seat[client] = -1;
+            away.push_back(client);
+            writer.line(time + "4 " + names[client]);
+            if (!waiting.empty()) { // the club seats the first waiting client there
+                int next_client = waiting.front();
+                waiting.pop_front();
+                owner[table] = next_client;
+                seat[next_client] = table;
+                seated.push_back(next_client);
+            }
+        } else {
+            writer.line(time + "1 " + names[pick(names.size())]);
+        }
+    }
+    writer.flush();
+    return writer.written();
+}
+}
+
+uint64_t generate_log(const Log_Generator_Options& options, std::FILE* output)
+{
+    Log_Writer writer(output, nullptr);
+    return generate(options, writer);
+}
+std::string generate_log(const Log_Generator_Options& options)
+{
+    std::string text;
+    {
+        Log_Writer writer(nullptr, &text);
+        generate(options, writer);
+    }
+    return text;
+}
@@ -0,0 +1,33 @@
+#ifndef RECRUITMENT_TEST_LOG_GENERATOR_H
+#define RECRUITMENT_TEST_LOG_GENERATOR_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+struct Log_Generator_Options {
+    uint64_t seed = 1;
+    int tables = 10;
+    int clients = 100; // size of the pool client names are drawn from
+    int cost_per_hour = 10;
+    int open_minute = 9 * 60;
+    int close_minute = 21 * 60;
+    int days = 0; // 0: one undated day, else this many dated shifts from 2024-01-01
+    uint64_t events = 1000; // stop after this many event lines...
+    uint64_t bytes = 0; // ...or, if non-zero, once the log is at least this big
+    double queue_pressure = 0.5; // 0..1, how often clients arrive instead of leaving
+    double error_rate = 0.05; // 0..1, share of events that are deliberately wrong
+};
+
+// Writes a club log (header and events in time order) that follows a plausible
+// day: clients arrive, sit at free tables, queue up when the club is full and
+// leave. error_rate of the events are malformed or break a rule on purpose
+// (unknown clients, busy tables, invalid names, arrivals before opening...).
+// With days, the events are spread over that many shifts, a shift that closes
+// at or before its opening time running past midnight; everyone leaves at
+// closing time, as in the club.
+// The same options always produce the same log. Returns the bytes written.
+uint64_t generate_log(const Log_Generator_Options& options, std::FILE* output);
+std::string generate_log(const Log_Generator_Options& options);
+
+#endif // RECRUITMENT_TEST_LOG_GENERATOR_H